@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+# Evaluations the genetic algorithm needs to reach a score, for each value of an operator option.
+#
+# Usage: bench/operators.sh <config-file> <target-score> <runs> <delay_in_sec> <option> <value>...
+# e.g.   bench/operators.sh configs/42_project 60000 8 3 crossover index cycle subsequence
+# Each run prints the evaluations of the first generation whose best score reaches the target (from --ga-stats),
+# or "-" if it is not reached within the delay. Run from the repository root, after make.
+set -euo pipefail
+
+config=${1:?config file}
+target=${2:?target score}
+runs=${3:?runs}
+delay=${4:?delay}
+option=${5:?option}
+shift 5
+
+for value in "$@"; do
+    results=()
+    for ((run = 0; run < runs; ++run)); do
+        evaluations=$(./krpsim --ga-stats --refine=0 --"$option"="$value" --output=/dev/null "$config" "$delay" 2>&1 \
+            | awk -v target="$target" '/^generation/ {
+                  score = $5; sub(",", "", score)
+                  for (i = 1; i < NF; ++i) if ($i == "evaluations") evaluations = $(i + 1)
+                  if (!found && score + 0 >= target + 0) { found = 1; print evaluations }
+              }')
+        results+=("${evaluations:--}")
+    done
+    reached=$(printf '%s\n' "${results[@]}" | grep -vc -- '-' || true)
+    mean=$(printf '%s\n' "${results[@]}" | awk '$1 != "-" { sum += $1; n++ } END { print n ? int(sum / n) : "-" }')
+    printf '%-12s reached %d/%d, mean evaluations %s: %s\n' "$value" "$reached" "$runs" "$mean" "${results[*]}"
+done
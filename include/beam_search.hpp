@@ -0,0 +1,40 @@
+/*!
+ *  @file beam_search.hpp
+ *  @brief Header file for the beam search solver of krpsim
+ *
+ *  The beam search keeps, at each depth, the best simulation states according to the distance-weighted score of
+ *  their stocks once the running processes finish. A step from a state launches one or all possible copies of a
+ *  launchable process, or waits for the next running processes to finish.
+ */
+
+#ifndef BEAM_SEARCH_HPP
+#define BEAM_SEARCH_HPP
+
+#include "krpsim.hpp"
+#include "simulation.hpp"
+#include <cmath>
+
+///< @brief Parameters of the beam search.
+struct BeamParameters {
+    int         width = 64;             ///< Number of states kept at each depth
+    unsigned    threads = 0;            ///< Threads expanding the states, 0 for all cores
+    int         maxCycles = MAX_CYCLES; ///< States at or after this cycle are not expanded
+    int         maxLaunches = 1000000;  ///< Maximum number of launches in a trace, bounds the copies launched at once
+    int         saturation = 16;        ///< A stock scores up to this many times the largest quantity a process needs of it
+    double      goal = HUGE_VAL;        ///< The search stops once a state reaches this quantity of the target
+};
+
+/**
+ * @brief Beam search for a krpsim trace.
+ *
+ * States are expanded in parallel, children reaching the same state (same cycle, stocks and running processes)
+ * are merged by hashing before keeping the best `width` ones.
+ *
+ * @param cfg           Parsed configuration
+ * @param timeBudgetMs  Wall-clock budget
+ * @param params        Width, threads and horizon of the search
+ * @return The best state met, with its trace
+ */
+Candidate solve_with_beam(const Config &cfg, long timeBudgetMs, const BeamParameters &params = {});
+
+#endif
@@ -0,0 +1,60 @@
+/*!
+ *  @file bounds.hpp
+ *  @brief Header file for the upper bounds on the optimization target of krpsim
+ *
+ *  Two relaxations of the scheduling problem give upper bounds on the quantity of the target a trace can reach:
+ *  - the linear relaxation over the number of launches of each process, which ignores time,
+ *  - the cumulative availability of each item over the horizon, which ignores that a stock can be used only once.
+ *  Both are infinite when the configuration has a cycle producing more than it consumes, or processes without needs.
+ */
+
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include "krpsim.hpp"
+#include <vector>
+
+/**
+ * @brief Function to find the item optimized by the configuration.
+ *
+ * @return The ID of the first optimize key that is not "time", -1 if only time is optimized.
+ */
+int target_item(const Config &cfg);
+
+/**
+ * @brief Function to bound the target with the linear relaxation of the launch counts.
+ *
+ * Maximizes the target over real launch counts x >= 0 such that no stock goes negative once every launch finished
+ * (available + (results - needs) x >= 0), with the simplex algorithm.
+ *
+ * @param cfg The configuration, with its process table.
+ * @param available The stocks to start from, indexed by item ID.
+ * @return The bound, infinite if the relaxation is unbounded or too large to solve.
+ */
+double lp_target_bound(const Config &cfg, const std::vector<int> &available);
+
+/**
+ * @brief Function to bound the target with the cumulative availability of the items over a horizon.
+ *
+ * An item can never have been available in larger quantity at cycle t than its available stock plus what the
+ * launches finished by t could produce, each process being launched as often as the availability of its needs at
+ * its launch allows. Launches start at the latest at the horizon.
+ *
+ * @param cfg The configuration, with its process table.
+ * @param available The stocks to start from, indexed by item ID.
+ * @param horizon Last cycle a process can be launched at.
+ * @return The bound, infinite if it overflows.
+ */
+double horizon_target_bound(const Config &cfg, const std::vector<int> &available, int horizon);
+
+/**
+ * @brief Function to bound the target, the lowest of the linear and horizon bounds.
+ *
+ * @param cfg The configuration, with its process table.
+ * @param available The stocks to start from, with the results of the running processes added.
+ * @param horizon Last cycle a process can be launched at.
+ * @return The bound, infinite if only time is optimized or if no relaxation bounds the target.
+ */
+double target_upper_bound(const Config &cfg, const std::vector<int> &available, int horizon);
+
+#endif
@@ -0,0 +1,41 @@
+/*!
+ *  @file exact.hpp
+ *  @brief Header file for the exact branch-and-bound solver of krpsim
+ *
+ *  The exact solver explores every schedule depth first: at each state, it launches k copies of a launchable
+ *  process, waits for the next running processes to finish, or stops and lets them finish. Launches at the same
+ *  cycle are made in increasing process ID order, so a set of launches is only explored once. A state is cut when
+ *  the upper bound on the target from its stocks (see bounds.hpp) cannot beat the best schedule found, or when it
+ *  was already explored at the same or an earlier cycle (see StateTable). Meant for small configurations, as
+ *  regression baselines.
+ */
+
+#ifndef EXACT_HPP
+#define EXACT_HPP
+
+#include "krpsim.hpp"
+#include "simulation.hpp"
+
+///< @brief Parameters of the exact solver.
+struct ExactParameters {
+    unsigned    threads = 0;            ///< Threads exploring subtrees, 0 for all cores
+    int         maxCycles = MAX_CYCLES; ///< No process is launched at or after this cycle
+    size_t      maxStates = 1 << 22;    ///< Explored states remembered by the transposition table
+};
+
+/**
+ * @brief Branch-and-bound search for a krpsim trace maximizing the target, then minimizing the cycles.
+ *
+ * The greedy schedule is the first incumbent. Each thread explores its own stack of states and steals the oldest
+ * states, the largest subtrees, of another thread when its stack runs out. All threads share the incumbent and the
+ * transposition table.
+ *
+ * @param cfg           Parsed configuration
+ * @param timeBudgetMs  Wall-clock budget
+ * @param params        Threads and horizon of the search
+ * @param optimal       Set to whether the search explored every schedule within the budget, if not null
+ * @return The best schedule, its running processes finished
+ */
+Candidate solve_exact(const Config &cfg, long timeBudgetMs, const ExactParameters &params = {}, bool *optimal = nullptr);
+
+#endif
@@ -13,6 +13,7 @@
 #define COMPUTE_GA_HPP
 
 #include "krpsim.hpp"     // Config, Process, Item  (+ <vector>/<string>)
+#include "simulation.hpp" // Candidate, RunningProcess, RunPQ
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -22,45 +23,106 @@
 #include <cmath>
 #include <chrono>
 #include <optional>
+#include <ostream>
+#include <random>
 
 
-///< @brief Represents a launch event in the simulation, containing a cycle and the ID of the process that starts at that cycle.
-struct TraceEntry {
-    long cycle; ///< launch time (cycle)
-    int procId; ///< ID of the process that starts at that cycle
+///< @brief Crossover operators of the genetic algorithm.
+enum class Crossover {
+    Index,          ///< Follow both parents by position in their traces, which drifts as waits are not in the traces
+    Cycle,          ///< Launches of parent1 before a random cut cycle, then of parent2, each at the cycle of its parent
+    Subsequence,    ///< Launches of parent1 before a random cut cycle, then of parent2 in their order, as soon as possible
 };
 
-
-///< @brief Running process in the simulation
-struct RunningProcess {
-    int finish; ///< finish time of the process
-    int id;     ///< process ID
-
-    bool operator>(const RunningProcess& o) const noexcept { return finish > o.finish; } ///< comparison operator for priority queue
-    RunningProcess() = default;
-    RunningProcess(int f, int i) : finish(f), id(i) {}
+///< @brief Mutation operators of the genetic algorithm.
+enum class Mutation {
+    Uniform,        ///< A random step picks a launchable process or the wait uniformly
+    Weighted,       ///< A random step favors the processes closer to the target (see mutation_weights)
+    Block,          ///< Uniform random steps, and every step is random over a window of launches of each child
 };
 
+/**
+ * @brief Parameters for the genetic algorithm.
+ *
+ * This struct contains parameters that control the behavior of the genetic algorithm,
+ * such as the maximum number of iterations, population size, mutation rate, and weights for the fitness function.
+ */
+struct GeneticParameters {
+    int maxIter = 1000;         ///< Maximum number of iterations for the genetic algorithm
+    int populationSize = 100;   ///< Size of the population in the genetic algorithm
+    int maxCycles = MAX_CYCLES; ///< Maximum number of cycles to run the simulation
+    double mutationRate = 10.0;  ///< Percentage (0-100) of mutation in the genetic algorithm
+    double score_alpha = 1.0;   ///< Weight for the target stock in the fitness function
+    double score_beta = 0.1;    ///< Weight for the other stocks in the fitness function
+    double score_decay = 0.7;   ///< Decay factor for the other
+    double goal = HUGE_VAL;     ///< Quantity of the target at which the search stops, typically its upper bound
+    int fingerprintLaunches = 64; ///< Launches from the start of a trace hashed into its fingerprint
+    std::ostream *stats = nullptr; ///< Per-generation statistics are written there, if not null
+    Crossover crossover = Crossover::Index; ///< How children inherit the launches of their parents
+    Mutation mutation = Mutation::Uniform;  ///< How the random steps of children are chosen
+    int blockLength = 32;       ///< Launches re-randomized by a block mutation
+};
 
-///< @brief Running process queue in the simulation
-using RunPQ = std::priority_queue<RunningProcess, std::vector<RunningProcess>, std::greater<RunningProcess>>;
 
+///< @brief Random source of the genetic algorithm policy, solvers running the policy in parallel use one per thread
+using PolicyRandom = std::minstd_rand;
 
-///< @brief Candidate in the genetic algorithm
-struct Candidate {
-    int                     cycle{};        ///< current cycle in the simulation, initially 0
-    std::vector<int>        stocks_by_id;   ///< current stock of items, indexed by item ID
-    RunPQ                   running;        ///< running processes in the simulation, ordered by finish time
-    std::vector<TraceEntry> trace;          ///< trace of launch events leading to this node
+///< @brief Random steps of the genetic algorithm policy.
+struct PolicyMutation {
+    double                      rate = 10.0;        ///< Percentage (0-100) of steps that are random
+    const std::vector<double>   *weights = nullptr; ///< Weight of each process in a random step, uniform if null
+    size_t                      block_begin = 0;    ///< Every step is random once the child trace has this many launches...
+    size_t                      block_end = 0;      ///< ... and until it has this many
 };
 
+/**
+ * @brief Function to weight the processes in the random steps by their distance to the target.
+ *
+ * The weight of a process is decay^d, with d the smallest distance to the target (cfg.dist) of its results, or one
+ * more than the largest distance if none of its results leads to the target.
+ */
+std::vector<double> mutation_weights(const Config &cfg, double decay);
+
+/**
+ * @brief Function to take the processes of obvious cycles out of the runnable list before a policy step.
+ *
+ * They are parked until the end of the step (see restore_parked), one of them stays runnable if nothing else can
+ * be done.
+ */
+void prepare_policy_step(RunnableSet &set, const Config &cfg, const Candidate &candidate);
+
+/**
+ * @brief Function to check whether a simulation reached maxCycles or can neither launch nor wait anymore.
+ */
+bool simulation_over(const Candidate &candidate, const RunnableSet &set, int maxCycles);
+
+/**
+ * @brief Function to simulate the policy of the genetic algorithm from the current state until the simulation is over.
+ *
+ * Each step copies the launches at the same position in the trace of a parent, or mutates: launches one copy of a
+ * random runnable process or waits. Without parents, every step is a mutation. The simulation stops early once it
+ * reaches a steady state, which is extrapolated until maxCycles.
+ *
+ * @param child The candidate to continue, its runnable set prepared by restore_parked and delete_high_stock_processes.
+ * @param set The runnable set of the candidate.
+ * @param cfg The configuration containing the processes.
+ * @param maxCycles The cycle at which the simulation stops.
+ * @param mutation Share of the steps that mutate instead of following a parent, and how they are drawn.
+ * @param random The random source of the policy.
+ * @param parent1 The first parent, or nullptr.
+ * @param parent2 The second parent, or nullptr.
+ * @param position Position in the parent traces of the first step, the launches already in the child trace.
+ */
+void run_policy(Candidate &child, RunnableSet &set, const Config &cfg, int maxCycles, const PolicyMutation &mutation,
+                PolicyRandom &random, const Candidate *parent1 = nullptr, const Candidate *parent2 = nullptr, int position = 0);
 
 /*!
  * @brief Genetic‑algorithm search for a near‑optimal krpsim trace.
  * @param cfg           Parsed configuration
  * @param timeBudgetMs  Wall‑clock budget granted by the grader (argv[2] in subject)
+ * @param params        Population, mutation rate, fitness weights and goal of the search
  * @return Vector of launch events sorted by increasing cycle, ready to print
  */
-Candidate solve_with_ga(const Config &cfg, long timeBudgetMs);
+Candidate solve_with_ga(const Config &cfg, long timeBudgetMs, const GeneticParameters &params = {});
 
 #endif
@@ -0,0 +1,38 @@
+/*!
+ *  @file greedy.hpp
+ *  @brief Header file for the greedy solver of krpsim
+ *
+ *  The greedy solver is deterministic: at each cycle, it goes through the processes closest to the target first
+ *  (by cfg.dist of their results) and launches as many copies of each as the stocks and maxStocks allow, then waits
+ *  for the next running processes to finish. A step is linear in the size of the process table.
+ */
+
+#ifndef GREEDY_HPP
+#define GREEDY_HPP
+
+#include "krpsim.hpp"
+#include "simulation.hpp"
+
+///< @brief Parameters of the greedy solver.
+struct GreedyParameters {
+    int     maxCycles = MAX_CYCLES; ///< The simulation stops at this cycle
+    int     maxLaunches = 1000000;  ///< Maximum number of launches in the trace, bounds the copies launched at once
+    int     saturation = 1;         ///< Intermediate items are produced up to this many times the largest quantity a process needs
+};
+
+/**
+ * @brief Greedy schedule for a krpsim trace.
+ *
+ * Processes none of whose results lead to the target are never launched, unless only time is optimized. A process
+ * is not launched once its results, counting the running processes, would exceed the saturation of each. Like the
+ * policy of the genetic algorithm, processes in obvious cycles are only launched when nothing else can be, and the
+ * simulation stops early once it reaches a steady state, which is extrapolated until maxCycles.
+ *
+ * @param cfg           Parsed configuration
+ * @param timeBudgetMs  Wall-clock budget, the schedule found so far is returned once it runs out
+ * @param params        Horizon of the simulation
+ * @return The greedy schedule, with its trace
+ */
+Candidate solve_with_greedy(const Config &cfg, long timeBudgetMs, const GreedyParameters &params = {});
+
+#endif
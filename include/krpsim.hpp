@@ -14,6 +14,7 @@
 #include <vector>
 #include <unordered_map>
 #include <fstream>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 
@@ -34,6 +35,7 @@ struct Process {
     std::vector<Item>   results;    ///< Items produced by the process, each with a name and quantity.
     int                 delay;      ///< Delay in cycles for the process to complete.
     bool                in_cycle{}; ///< Whether the process is in an obvious cycle.
+    int                 source_id{}; ///< Index of the process in the configuration file (stable across process selection).
 
     std::vector<std::pair<int,int>> needs_by_id;    ///< Needs of the process, each pair contains item ID and quantity.
     std::vector<std::pair<int,int>> results_by_id;  ///< Results of the process, each pair contains item ID and quantity.
@@ -46,6 +48,32 @@ struct MaxStocks {
     std::vector<double>                     factor_by_id;             ///< Factor to calculate max stock from current limiting item stock at each process choice, keyed by item ID. If -1.0, means no limit on the item.
 };
 
+///< @brief Represents a launch event in the simulation, containing a cycle and the ID of the process that starts at that cycle.
+struct TraceEntry {
+    long cycle; ///< launch time (cycle)
+    int procId; ///< ID of the process that starts at that cycle
+};
+
+/**
+ * @brief Processes flattened in compressed sparse row form, for the simulation hot path.
+ *
+ * The needs of process p are [need_offsets[p], need_offsets[p + 1]) in need_item / need_qty, its results
+ * [result_offsets[p], result_offsets[p + 1]) in result_item / result_qty. The processes needing item i are
+ * [needer_offsets[i], needer_offsets[i + 1]) in needer_pid / needer_qty, sorted by increasing quantity.
+ */
+struct ProcessTable {
+    std::vector<int>    need_offsets;   ///< Index of the first need of each process, plus the total number of needs.
+    std::vector<int>    need_item;      ///< Item ID of each need.
+    std::vector<int>    need_qty;       ///< Quantity of each need.
+    std::vector<int>    result_offsets; ///< Index of the first result of each process, plus the total number of results.
+    std::vector<int>    result_item;    ///< Item ID of each result.
+    std::vector<int>    result_qty;     ///< Quantity of each result.
+    std::vector<int>    delay;          ///< Delay of each process.
+    std::vector<int>    needer_offsets; ///< Index of the first needer of each item, plus the total number of needers.
+    std::vector<int>    needer_pid;     ///< Process ID of each needer.
+    std::vector<int>    needer_qty;     ///< Quantity of the item each needer needs.
+};
+
 ///< @brief Configuration structure for the resource management system.
 struct Config {
     std::unordered_map<std::string, int>    initialStocks;  ///< Initial stock of items, keyed by item name.
@@ -57,7 +85,10 @@ struct Config {
     std::unordered_map<std::string,int>     item_to_id;     ///< Mapping from item name to its ID, used for quick access.
     std::vector<std::string>                id_to_item;     ///< Mapping from item ID to its name, used for quick access.
 
-    std::vector<std::vector<std::pair<int,int>>>    needers_by_item;   ///< List of processes that need each item, each pair contains process ID and quantity needed ([item_id] -> {(pid, qty), ...})
+    uint64_t                                source_hash{};          ///< Hash of the parsed stocks, processes and optimize keys, identifies the configuration in binary traces.
+    int                                     source_process_count{}; ///< Number of processes declared in the configuration file.
+
+    ProcessTable                            table;          ///< Processes and needers of each item packed contiguously, built from needs_by_id / results_by_id.
 };
 
 #endif
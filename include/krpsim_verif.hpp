@@ -8,20 +8,197 @@
 #ifndef KRPSIM_KRPSIM_VERIF_HPP
 #define KRPSIM_KRPSIM_VERIF_HPP
 
-#include <vector>
+#include "krpsim.hpp"
+#include "trace_io.hpp"
+
+#include <cstdio>
 #include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 ///< @brief Running process in the simulation
 struct RunningProcess {
-    int finish; ///< finish time of the process
-    int id;     ///< process ID
+    long finish; ///< finish time of the process
+    int id;      ///< process ID
 
     bool operator>(const RunningProcess& o) const noexcept { return finish > o.finish; } ///< comparison operator for priority queue
     RunningProcess() = default;
-    RunningProcess(int f, int i) : finish(f), id(i) {}
+    RunningProcess(long f, int i) : finish(f), id(i) {}
 };
 
 ///< @brief Running process queue in the simulation
 using RunPQ = std::priority_queue<RunningProcess, std::vector<RunningProcess>, std::greater<RunningProcess>>;
 
-#endif
\ No newline at end of file
+///< @brief Mapping from process name to process ID, the views point to the names stored in the Config.
+using ProcessLookup = std::unordered_map<std::string_view, int>;
+
+///< @brief Result of the verification of a trace.
+struct VerifResult {
+    bool                valid = false;  ///< Whether the trace is valid.
+    long                cycle = 0;      ///< Last cycle, once every launched process is finished.
+    size_t              lines = 0;      ///< Number of lines read from the trace.
+    size_t              launches = 0;   ///< Number of process launches replayed.
+    std::vector<long>   stocks;         ///< Final stocks, indexed by item ID.
+    std::string         error;          ///< Error message if the trace is not valid.
+};
+
+
+/**
+ * @brief Replays process launches against a configuration, with stocks indexed by item ID.
+ *
+ * Launches must be given in trace order. Results of a running process are added to the stocks
+ * once a later launch (or finish()) reaches its finish cycle.
+ *
+ * A repeated period (compressed trace) is replayed once, then checked to be repeatable: the running processes
+ * relative to the start of the next repetition are the same and no stock decreased over the period. Since more
+ * stock never makes a launch invalid, every later repetition is then valid too, and the state is extrapolated
+ * to the start of the last repetition, which is replayed explicitly before the rest of the trace.
+ */
+class TraceReplayer {
+public:
+    explicit TraceReplayer(const Config &cfg);
+
+    /**
+     * @brief Launch a process at a given cycle.
+     * @return false if a needed stock is insufficient, the error is then set.
+     */
+    bool launch(long cycle, int pid);
+
+    /**
+     * @brief Announce that the next `period.length` launches are repeated `period.times` times.
+     * @return false if the directive is invalid or a previous period is not complete, the error is then set.
+     */
+    bool begin_repeat(const TracePeriod &period);
+
+    /**
+     * @brief Finish every running process and fill the result.
+     * @return false if a repeated period is incomplete, the error is then set.
+     */
+    bool finish(VerifResult &result);
+
+    const std::string &error() const noexcept { return error_; } ///< Error of the last failed launch.
+    size_t launches() const noexcept { return launches_; }       ///< Number of launches replayed so far.
+
+private:
+    void resolve_finished_processes(long cycle);
+    bool launch_one(long cycle, int pid);
+    bool repeat_period();
+    std::vector<RunningProcess> relative_running(long cycle) const;
+
+    const Config        &cfg_;
+    std::vector<long>   stocks_;
+    RunPQ               running_;
+    long                cycle_ = 0;
+    size_t              launches_ = 0;
+    std::string         error_;
+
+    TracePeriod                 period_;            ///< Repeat directive being replayed
+    std::vector<TraceEntry>     period_entries_;    ///< Entries of the first repetition
+    std::vector<long>           period_stocks_;     ///< Stocks at the start of the first repetition
+    std::vector<RunningProcess> period_running_;    ///< Running processes relative to the start of the first repetition
+    long                        period_cycle_ = 0;  ///< Cycle of the first entry of the first repetition
+};
+
+
+/**
+ * @brief Buffered reader of trace lines, with no allocation per line.
+ *
+ * The file is read in large blocks, a line is returned as a view into the internal buffer
+ * that stays valid until the next call to next().
+ */
+class TraceLineReader {
+public:
+    explicit TraceLineReader(std::FILE *file, size_t buffer_size = 1 << 22);
+
+    /**
+     * @brief Read the next line (without the trailing newline).
+     * @return false at the end of the file.
+     */
+    bool next(std::string_view &line);
+
+private:
+    bool refill();
+
+    std::FILE           *file_;
+    std::vector<char>   buffer_;
+    size_t              begin_ = 0;
+    size_t              end_ = 0;
+    bool                eof_ = false;
+};
+
+
+///< @brief Kind of a trace line.
+enum class TraceLineKind {
+    SKIP,       ///< Empty line or comment
+    LAUNCH,     ///< <cycle>:<process_name>
+    REPEAT,     ///< @repeat:<length>:<shift>:<times>
+    OTHER       ///< Any other line
+};
+
+/**
+ * @brief Parse a trace line shaped like `<cycle>:<process_name>` (surrounding spaces allowed).
+ *
+ * @param line The line to parse.
+ * @param cycle Receives the cycle if the line is a launch.
+ * @param name Receives the process name if the line is a launch.
+ * @return The kind of the line.
+ */
+TraceLineKind parse_trace_line(std::string_view line, long &cycle, std::string_view &name);
+
+/**
+ * @brief Parse a repeat directive line `@repeat:<length>:<shift>:<times>`.
+ *
+ * @param line The line (detected as TraceLineKind::REPEAT).
+ * @param period Receives length, shift and times.
+ * @return false if the directive is malformed.
+ */
+bool parse_repeat_line(std::string_view line, TracePeriod &period);
+
+/**
+ * @brief Build the name to ID lookup of the processes of a configuration.
+ */
+ProcessLookup build_process_lookup(const Config &cfg);
+
+/**
+ * @brief Verify a text trace read from a file.
+ *
+ * Lines shaped like `<cycle>:<process_name>` are replayed, other lines before the first launch are ignored
+ * and the first other line after it ends the trace.
+ *
+ * @param cfg The configuration (with item IDs built).
+ * @param lookup The process name to ID lookup.
+ * @param file The trace file.
+ * @return The verification result.
+ */
+VerifResult verify_trace(const Config &cfg, const ProcessLookup &lookup, std::FILE *file);
+
+/**
+ * @brief Verify a binary trace read from a file.
+ *
+ * The trace must have been produced for this configuration (same hash and process count).
+ *
+ * @param cfg The configuration (with item IDs built), processes in file order.
+ * @param file The trace file, positioned at its start.
+ * @return The verification result, lines being the number of entries.
+ */
+VerifResult verify_binary_trace(const Config &cfg, std::FILE *file);
+
+/**
+ * @brief Verify a text trace read from a file, parsing and replaying in a pipeline.
+ *
+ * A reader thread cuts the file in large blocks on newline boundaries, parser threads turn each block into
+ * compact (cycle, process ID) records and the calling thread replays the blocks in order. Verification then
+ * runs at replay speed rather than parse speed. The result is the same as verify_trace.
+ *
+ * @param cfg The configuration (with item IDs built).
+ * @param lookup The process name to ID lookup.
+ * @param file The trace file.
+ * @param parser_threads Number of parser threads (at least 1).
+ * @return The verification result.
+ */
+VerifResult verify_trace_pipelined(const Config &cfg, const ProcessLookup &lookup, std::FILE *file,
+                                   unsigned parser_threads);
+
+#endif
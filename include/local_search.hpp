@@ -0,0 +1,46 @@
+/*!
+ *  @file local_search.hpp
+ *  @brief Header file for the local search refining the trace found by a krpsim solver
+ *
+ *  The refinement is a simulated annealing over small edits of the trace: swap the processes of two launches, shift
+ *  a launch earlier, insert or remove a launch. An edited trace is checked and scored by replaying it, from the
+ *  checkpoint before the first edited launch.
+ */
+
+#ifndef LOCAL_SEARCH_HPP
+#define LOCAL_SEARCH_HPP
+
+#include "krpsim.hpp"
+#include "simulation.hpp"
+
+///< @brief Parameters of the local search.
+struct RefineParameters {
+    double  temperature = 0.001;    ///< Initial temperature, relative to the score of the trace, decreasing linearly to 0
+    int     window = 32;            ///< Maximum distance, in launches, between the two launches of a swap or a shift
+    int     checkpoints = 256;      ///< Number of replay states kept along the trace
+};
+
+/**
+ * @brief Refine a trace by simulated annealing.
+ *
+ * A trace reaching a steady state is edited in its compressed form (see TracePeriod): an edit in the period applies
+ * to every repetition, and the refined candidate keeps the period of the candidate. Its stocks and cycle are the
+ * ones once all running processes finish.
+ *
+ * @param cfg           Parsed configuration
+ * @param candidate     Candidate found by a solver
+ * @param timeBudgetMs  Wall-clock budget
+ * @param params        Temperature and move window
+ * @return The best trace met, or the candidate itself if none scores better
+ */
+Candidate refine_trace(const Config &cfg, const Candidate &candidate, long timeBudgetMs, const RefineParameters &params = {});
+
+/**
+ * @brief Check that a trace can be replayed from the initial stocks.
+ *
+ * The period, if active, must lead back to the same running processes without consuming stocks, as the verifier
+ * requires.
+ */
+bool trace_replays(const Config &cfg, const std::vector<TraceEntry> &trace, const TracePeriod &period);
+
+#endif
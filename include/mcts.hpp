@@ -0,0 +1,40 @@
+/*!
+ *  @file mcts.hpp
+ *  @brief Header file for the Monte Carlo tree search solver of krpsim
+ *
+ *  The tree nodes are the steps of the genetic algorithm policy (launch one copy of a process or wait), a leaf is
+ *  evaluated by a playout of that policy (run_policy) until the simulation is over. Like a child of the genetic
+ *  algorithm, the playout follows a parent, the best playout so far, and mutates some of its steps.
+ */
+
+#ifndef MCTS_HPP
+#define MCTS_HPP
+
+#include "krpsim.hpp"
+#include "simulation.hpp"
+#include <cmath>
+
+///< @brief Parameters of the Monte Carlo tree search.
+struct MctsParameters {
+    unsigned    threads = 0;            ///< Threads running iterations, 0 for all cores
+    int         maxCycles = MAX_CYCLES; ///< Playouts stop at this cycle
+    double      exploration = 0.7;      ///< Exploration constant of the UCT formula, scores being normalized to [0, 1]
+    double      mutationRate = 10.0;    ///< Percentage (0-100) of playout steps that do not follow the best playout
+    int         maxNodes = 1 << 22;     ///< Leaves are not expanded anymore once the tree has this many nodes
+    double      goal = HUGE_VAL;        ///< The search stops once a playout reaches this quantity of the target
+};
+
+/**
+ * @brief Monte Carlo tree search for a krpsim trace.
+ *
+ * Threads share the tree: a thread selects a leaf and expands it under a lock, then plays out without it. The nodes
+ * on the way get a virtual loss until the playout is scored, so other threads explore other branches meanwhile.
+ *
+ * @param cfg           Parsed configuration
+ * @param timeBudgetMs  Wall-clock budget
+ * @param params        Threads and exploration of the search
+ * @return The best playout, with its trace
+ */
+Candidate solve_with_mcts(const Config &cfg, long timeBudgetMs, const MctsParameters &params = {});
+
+#endif
@@ -0,0 +1,71 @@
+/*!
+ *  @file pareto.hpp
+ *  @brief Header file for the multi-objective solver of krpsim
+ *
+ *  The multi-objective solver does not fold the optimize keys into one score: it keeps the schedules no other
+ *  schedule beats on every objective, the Pareto front. The objectives are the stock of each optimized item, to
+ *  maximize, and the total cycles, to minimize, whether time is listed in the optimize keys or not. The search is
+ *  NSGA-II: each generation, the children of the population and the population are sorted by non-dominated fronts,
+ *  and the best fronts make the next population, the most isolated schedules first within the last one.
+ */
+
+#ifndef PARETO_HPP
+#define PARETO_HPP
+
+#include "krpsim.hpp"
+#include "simulation.hpp"
+#include <ostream>
+#include <string>
+#include <vector>
+
+///< @brief Parameters of the multi-objective solver.
+struct ParetoParameters {
+    unsigned        threads = 0;                ///< Threads simulating the children, 0 for all cores
+    int             maxCycles = MAX_CYCLES;     ///< No schedule is simulated past this cycle
+    int             maxIter = 1000;             ///< Maximum number of generations
+    int             populationSize = 100;       ///< Schedules kept from one generation to the next
+    double          mutationRate = 10.0;        ///< Percentage (0-100) of the steps and horizons of a child that are random
+    int             fingerprintLaunches = 64;   ///< Launches from the start of a trace hashed into its fingerprint
+    std::ostream    *stats = nullptr;           ///< Per-generation statistics are written there, if not null
+};
+
+/**
+ * @brief Function to name the objectives of a configuration: the optimized items in optimize order, then "time".
+ */
+std::vector<std::string> pareto_objective_names(const Config &cfg);
+
+/**
+ * @brief Function to compute the objectives of a schedule, in the order of pareto_objective_names.
+ *
+ * Every objective is to maximize: the stock of each optimized item, then minus the total cycles.
+ */
+std::vector<long> pareto_objectives(const Config &cfg, const Candidate &candidate);
+
+/**
+ * @brief Function to pick the schedule of a front with the best weighted sum of its objectives.
+ *
+ * Each objective is normalized to [0, 1] over the front before weighting, so weights compare the objectives in
+ * relative terms. Ties go to the schedule with the most of the first optimized item, and so on, then the fewest
+ * cycles.
+ *
+ * @param weights Weight of each objective, in the order of pareto_objective_names.
+ * @return The index of the schedule in the front.
+ */
+size_t select_tradeoff(const Config &cfg, const std::vector<Candidate> &front, const std::vector<double> &weights);
+
+/**
+ * @brief NSGA-II search for the Pareto front of krpsim traces.
+ *
+ * Each schedule of the population runs the genetic algorithm policy until its own horizon, a cycle at which it
+ * stops launching: short horizons trade stocks for cycles. Children follow two parents chosen by binary tournament
+ * on (front, crowding distance), take the horizon of one of them or a random one, and are simulated in parallel.
+ * The greedy schedule seeds the population.
+ *
+ * @param cfg           Parsed configuration
+ * @param timeBudgetMs  Wall-clock budget
+ * @param params        Population, threads and horizon of the search
+ * @return The schedules of the front, their running processes finished, one per distinct objectives, by increasing cycles
+ */
+std::vector<Candidate> solve_pareto(const Config &cfg, long timeBudgetMs, const ParetoParameters &params = {});
+
+#endif
@@ -17,6 +17,19 @@
 
 #include "krpsim.hpp"
 
+///< @brief Wall-clock duration of one stage of the configuration preparation.
+struct StageTiming {
+    std::string name;   ///< Name of the stage (parse, dist, select, index, max_stocks, cycles, process_table).
+    double      ms;     ///< Duration of the stage in milliseconds.
+};
+
+///< @brief Options controlling how parse_config_for_simulation prepares the configuration.
+struct ParseOptions {
+    unsigned                    parse_threads = 1;      ///< Threads used to parse the process section (1: sequential, 0: all cores).
+    bool                        parallel_prep = true;   ///< Run independent preparation passes concurrently.
+    std::vector<StageTiming>*   timings = nullptr;      ///< If not null, receives the duration of each stage.
+};
+
 /**
  * @brief Parse the configuration from an input stream.
  *
@@ -30,15 +43,50 @@
  */
 Config parse_config(std::istream &in);
 
+/**
+ * @brief Parse the configuration from an input stream, parsing the process section in parallel.
+ *
+ * The whole input is read in memory. Stocks are parsed sequentially, then the rest of the file is split
+ * in chunks on newline boundaries, each chunk being parsed on a worker thread until it reaches a line that is
+ * not a process. Chunks are merged in file order, so processes keep the order of the file, and the optimize
+ * section is parsed sequentially from the first non-process line. Errors and duplicate-name detection are the
+ * same as parse_config.
+ *
+ * @param in The input stream to read the configuration from.
+ * @param thread_count Number of chunks/worker threads, 0 to use all available cores.
+ * @return A Config struct containing the parsed configuration.
+ * @throws std::runtime_error if the configuration is malformed.
+ */
+Config parse_config_chunked(std::istream &in, unsigned thread_count);
+
+/**
+ * @brief Build the item index and IDs for the configuration.
+ *
+ * Fills item_to_id / id_to_item and the needs_by_id / results_by_id vectors of each process.
+ *
+ * @param cfg The configuration to build the item index for.
+ */
+void build_item_index_and_ids(Config& cfg);
+
+/**
+ * @brief Build the flattened process table of the configuration from the needs_by_id / results_by_id of each process.
+ *
+ * @param cfg The configuration, indexed by build_item_index_and_ids.
+ */
+void build_process_table(Config& cfg);
+
 /**
  * @brief Parse the configuration for simulation purposes.
  *
  * This function parses the configuration from an input stream, initializes the distance map for optimization keys,
- * selects necessary processes, builds item indices and IDs, and prepares the needers_by_item vector.
+ * selects necessary processes, builds item indices and IDs, and builds the flattened process table.
+ * The preparation passes are run as a small task graph: passes that do not depend on each other
+ * (distance map and process selection, then max stocks, cycle detection and process table) run concurrently.
  *
  * @param in The input stream to read the configuration from.
+ * @param opts Options for the preparation (parallelism, timing output).
  * @return A Config object containing the parsed and prepared configuration for simulation.
  */
-Config parse_config_for_simulation(std::istream &in);
+Config parse_config_for_simulation(std::istream &in, const ParseOptions &opts = {});
 
 #endif
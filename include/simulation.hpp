@@ -0,0 +1,273 @@
+/*!
+ *  @file simulation.hpp
+ *  @brief Header file for the simulation steps shared by the krpsim solvers
+ *
+ *  This file defines the state of a simulation (Candidate), the set of launchable processes kept up to date
+ *  while simulating (RunnableSet), and the steps moving a simulation forward: launching several copies of a
+ *  process at the current cycle, or waiting for the next running processes to finish. The steps keep a hash of the
+ *  state up to date, so that solvers can recognize states reached before.
+ */
+
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include "krpsim.hpp"     // Config, Process, TraceEntry
+#include "trace_io.hpp"   // TracePeriod
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+
+///< @brief Cycle at which the solvers stop simulating, unless their parameters say otherwise
+constexpr int MAX_CYCLES = 50000;
+
+
+///< @brief Running processes in the simulation, count copies of the same process finishing at the same time
+struct RunningProcess {
+    int finish; ///< finish time of the process
+    int id;     ///< process ID
+    int count;  ///< number of copies launched together
+
+    bool operator>(const RunningProcess& o) const noexcept { return finish > o.finish; } ///< comparison operator for priority queue
+    RunningProcess() = default;
+    RunningProcess(int f, int i, int c = 1) : finish(f), id(i), count(c) {}
+};
+
+
+///< @brief Running process queue in the simulation
+using RunPQ = std::priority_queue<RunningProcess, std::vector<RunningProcess>, std::greater<RunningProcess>>;
+
+
+///< @brief Candidate in the genetic algorithm
+struct Candidate {
+    int                     cycle{};        ///< current cycle in the simulation, initially 0
+    std::vector<int>        stocks_by_id;   ///< current stock of items, indexed by item ID
+    RunPQ                   running;        ///< running processes in the simulation, ordered by finish time
+    std::vector<TraceEntry> trace;          ///< trace of launch events leading to this node
+    TracePeriod             period;         ///< steady state reached by the simulation, its period is stored once in trace
+    uint64_t                stock_hash{};   ///< Zobrist hash of stocks_by_id, kept up to date by the simulation steps
+    uint64_t                running_hash{}; ///< hash of the running processes relative to cycle, kept up to date by the simulation steps
+};
+
+
+///< @brief Processes that can be launched in a candidate, kept up to date by the simulation steps
+struct RunnableSet {
+    std::vector<int>    missing;        ///< number of needs each process lacks, indexed by process ID
+    std::vector<int>    runnable;       ///< launchable processes, plus -1 to wait for the next running process
+    std::vector<bool>   is_runnable;    ///< whether each process is in runnable
+    std::vector<int>    parked;         ///< launchable processes taken out of runnable, put back by restore_parked
+};
+
+
+///< @brief Weights of the distance-weighted score of a simulation state
+struct ScoreWeights {
+    double alpha = 1.0;     ///< Weight for the target stock
+    double beta = 0.1;      ///< Weight for the other stocks
+    double decay = 0.7;     ///< Decay of the weight of a stock with its distance to the target
+};
+
+
+/**
+ * @brief Function to score stocks for the optimization target of the configuration.
+ *
+ * The score is the target stock plus the other stocks weighted by decay^distance to the target (unreachable
+ * stocks are ignored). When only time is optimized, the score decreases with the cycle.
+ *
+ * @param stocks The stocks, indexed by item ID.
+ * @param cycle The cycle at which the stocks are reached.
+ * @param cfg The configuration containing the optimization keys and distance map.
+ * @param weights The weights of the score.
+ * @return An integer score, higher is better.
+ */
+int score_stocks(const std::vector<int> &stocks, int cycle, const Config &cfg, const ScoreWeights &weights = {});
+
+/**
+ * @brief Function to access the entries of a running queue, in heap order.
+ */
+const std::vector<RunningProcess> &running_entries(const RunPQ &running);
+
+/**
+ * @brief Function to mix the bits of a 64-bit value (splitmix64 finalizer), to build hashes from keys.
+ */
+uint64_t mix(uint64_t x);
+
+/**
+ * @brief Function to hash the state of a simulation: its stocks and its running processes relative to its cycle.
+ *
+ * The hash does not depend on the cycle, nor on how copies of a process finishing at the same time were launched.
+ * The parts are updated in O(1) per changed stock or running entry by the simulation steps: the stock part XORs a
+ * key per (item, stock), the running part sums key(process) * count * B^(finish - cycle) modulo 2^64, and is
+ * multiplied by B^-d when the cycle moves d cycles forward.
+ */
+uint64_t state_hash(const Candidate &candidate);
+
+///< @brief Fingerprint of a candidate, to tell apart candidates of a population cheaply
+struct TraceFingerprint {
+    uint64_t    prefix; ///< hash of the first launches of the trace
+    uint64_t    full;   ///< hash of the prefix, the cycle and the state reached (see state_hash)
+};
+
+/**
+ * @brief Function to fingerprint a candidate by the first launches of its trace and the state it reaches.
+ *
+ * Two candidates with the same full fingerprint are duplicates for a population: they start alike and end in the
+ * same state at the same cycle.
+ *
+ * @param candidate The candidate, its state hash up to date.
+ * @param launches Number of launches from the start of the trace in the prefix.
+ */
+TraceFingerprint trace_fingerprint(const Candidate &candidate, size_t launches);
+
+/**
+ * @brief Function to compute the hash parts of a candidate from scratch, after changing it outside the simulation steps.
+ */
+void rehash_state(Candidate &candidate);
+
+/**
+ * @brief Function to start a simulation from the initial stocks.
+ *
+ * @param candidate The candidate to reset at cycle 0.
+ * @param cfg The configuration containing the processes and initial stocks.
+ * @param set The runnable set to build, it contains the wait (-1).
+ */
+void init_simulation(Candidate &candidate, const Config &cfg, RunnableSet &set);
+
+/**
+ * @brief Function to compute how many copies of a process can be launched at once.
+ *
+ * @return The minimum over the needs of stock / quantity, 0 if the process cannot be launched. Needs of quantity 0
+ *         are left out, a process bounded by no need is launched once.
+ */
+int max_launches(const Candidate &candidate, const Config &cfg, int proc_id);
+
+/**
+ * @brief Function to compute how many copies of every process can be launched at once.
+ *
+ * Works on the needs of the flattened process table (Config::table): the stocks of all needs are gathered in one
+ * pass, the quotients stock / quantity are computed in a second pass written to be vectorized, and a last pass takes
+ * the minimum over the needs of each process.
+ *
+ * @param candidate The candidate whose stocks are used.
+ * @param cfg The configuration containing the process table.
+ * @param counts Set to max_launches of each process, indexed by process ID.
+ */
+void max_launches_all(const Candidate &candidate, const Config &cfg, std::vector<int> &counts);
+
+/**
+ * @brief Function to launch count copies of a process at the current cycle.
+ *
+ * Stocks are subtracted once for all copies, the copies share one entry in the running queue
+ * and one trace entry is added per copy.
+ *
+ * @param candidate The candidate to modify.
+ * @param cfg The configuration containing the processes.
+ * @param proc_id The ID of the process to launch.
+ * @param count The number of copies, at most max_launches(candidate, cfg, proc_id).
+ * @param set The runnable set to update.
+ * @param record Whether to add the launches to the trace, solvers keeping their own trace skip it.
+ */
+void apply_launches(Candidate &candidate, const Config &cfg, int proc_id, int count, RunnableSet &set, bool record = true);
+
+/**
+ * @brief Function to advance to the next finish time and collect the results of all processes finishing then.
+ */
+void wait_next_finish(Candidate &candidate, const Config &cfg, RunnableSet &set);
+
+/**
+ * @brief Function to let the running processes finish without launching anything: collect their results and move to
+ * the last finish time, where a replay of the trace ends.
+ *
+ * The runnable set is not updated, the candidate is meant to be scored or reported, not simulated further.
+ */
+void finish_running(Candidate &candidate, const Config &cfg);
+
+/**
+ * @brief Function to take a launchable process out of the runnable list until the next restore_parked.
+ */
+void park_process(RunnableSet &set, int proc_id);
+
+/**
+ * @brief Function to put back in the runnable list the parked processes that are still launchable.
+ */
+void restore_parked(RunnableSet &set);
+
+/**
+ * @brief Function to park processes that produce items with stocks exceeding configured limits.
+ *
+ * @param set The runnable set of the candidate.
+ * @param cfg The configuration containing the maximum stock limits.
+ * @param candidate The current candidate containing stock information.
+ */
+void delete_high_stock_processes(RunnableSet &set, const Config &cfg, const Candidate &candidate);
+
+
+/**
+ * @brief Detection of the steady state of a simulation.
+ *
+ * The state is recorded at each wait: running processes relative to the current cycle and stocks, keyed by a hash
+ * of the running processes. When the same running processes come back with no stock lower than before, the launches
+ * made in between can be repeated until the end of the simulation, so the rest of it can be extrapolated.
+ */
+class SteadyStateDetector {
+public:
+    /**
+     * @param max_states Maximum number of recorded states, bounds the memory used for long simulations.
+     */
+    explicit SteadyStateDetector(size_t max_states = 4096) : max_states_(max_states) {}
+
+    /**
+     * @brief Record the state of the candidate, or find the period leading back to a recorded state.
+     *
+     * @param candidate The candidate, just after a wait.
+     * @param period Set to the period found (one repetition) if any.
+     * @param stock_delta Set to the stocks produced by one repetition of the period.
+     * @return True if a period was found.
+     */
+    bool observe(const Candidate &candidate, TracePeriod &period, std::vector<int> &stock_delta);
+
+private:
+    ///< @brief State recorded at a wait.
+    struct State {
+        std::vector<RunningProcess> running;    ///< running processes, finish relative to the cycle, sorted and merged
+        std::vector<int>            stocks;     ///< stocks indexed by item ID
+        int                         cycle;      ///< cycle of the wait
+        size_t                      trace_size; ///< number of launches before the wait
+    };
+
+    static std::vector<RunningProcess> relative_running(const Candidate &candidate);
+
+    size_t                              max_states_;
+    std::unordered_map<uint64_t, State> states_;
+};
+
+/**
+ * @brief Function to repeat the period found by the steady state detection until the end of the simulation.
+ *
+ * The trace keeps a single copy of the period (see TracePeriod), the cycle, stocks and running processes are moved
+ * to the end of the last repetition. Repetitions start before maxCycles, as they would if simulated, and stop
+ * before a stock overflows.
+ *
+ * @param candidate The candidate, at the end of the first repetition of the period.
+ * @param period The period, with times set to 1.
+ * @param stock_delta The stocks produced by one repetition.
+ * @param maxCycles The cycle at which the simulation stops.
+ */
+void extrapolate_steady_state(Candidate &candidate, TracePeriod period, const std::vector<int> &stock_delta, int maxCycles);
+
+/**
+ * @brief Function to wait for the next running processes to finish, and extrapolate the simulation once its state
+ * repeats.
+ *
+ * @param candidate The candidate to advance.
+ * @param cfg The configuration containing the processes.
+ * @param set The runnable set to update.
+ * @param steady_state The detector recording the states of this simulation.
+ * @param maxCycles The cycle at which the simulation stops.
+ * @return True if a steady state was extrapolated until maxCycles: the simulation is over.
+ */
+bool wait_and_detect_steady_state(Candidate &candidate, const Config &cfg, RunnableSet &set,
+                                  SteadyStateDetector &steady_state, int maxCycles);
+
+#endif
@@ -0,0 +1,47 @@
+/*!
+ *  @file state_table.hpp
+ *  @brief Header file for the table of the simulation states reached by the krpsim solvers
+ *
+ *  The table records, for each state hash (see state_hash), the earliest cycle the state was reached at. A state
+ *  reached again later is dominated: the same launches are possible, only later. Threads share the table without
+ *  locks, and it never grows beyond its capacity.
+ */
+
+#ifndef STATE_TABLE_HPP
+#define STATE_TABLE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Bounded concurrent map from state hashes to the earliest cycle they were reached at.
+ *
+ * Open addressing with linear probing over a fixed array, slots are claimed by compare-and-swap and never freed.
+ */
+class StateTable {
+public:
+    /**
+     * @param capacity Maximum number of states, rounded up to a power of two.
+     */
+    explicit StateTable(size_t capacity);
+
+    /**
+     * @brief Record that a state is reached at a cycle.
+     *
+     * @return False if the state was already reached at this cycle or before, true otherwise (the cycle is then
+     * recorded). Once the probed slots are full, a new state is reported as such without being recorded.
+     */
+    bool visit(uint64_t hash, int cycle);
+
+    size_t size() const noexcept { return size_.load(std::memory_order_relaxed); } ///< Number of recorded states.
+
+private:
+    size_t                                      mask_;      ///< number of slots minus one
+    std::unique_ptr<std::atomic<uint64_t>[]>    keys_;      ///< hash of each slot, 0 for a free slot
+    std::unique_ptr<std::atomic<int>[]>         cycles_;    ///< earliest cycle of the state of each slot
+    std::atomic<size_t>                         size_{0};   ///< number of claimed slots
+};
+
+#endif
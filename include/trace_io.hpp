@@ -0,0 +1,225 @@
+/*!
+ *  @file trace_io.hpp
+ *  @brief Header file for the trace output of krpsim.
+ *
+ *  This file defines the TraceWriter, a buffered writer used to print the simulation trace
+ *  without going through iostreams, and the binary trace format shared by krpsim and krpsim_verif.
+ *
+ *  Binary trace layout (little endian):
+ *  - magic "KRPT", u8 version, 3 reserved bytes
+ *  - u64 hash of the configuration (Config::source_hash)
+ *  - u32 number of processes declared in the configuration
+ *  - u64 number of entries
+ *  - entries: zigzag varint of the cycle delta with the previous entry, then varint of the process ID
+ *    (index of the process in the configuration file). A process ID equal to the process count is a repeat
+ *    directive, followed by the varints length, zigzag shift and times (see TracePeriod).
+ *
+ *  Text traces use the same directive as a `@repeat:<length>:<shift>:<times>` line.
+ */
+
+#ifndef TRACE_IO_HPP
+#define TRACE_IO_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "krpsim.hpp"
+
+/**
+ * @brief Periodic part of a trace: a block of entries repeated several times with a constant cycle shift.
+ *
+ * In a compressed trace, the entries [start, start + length) are written once and stand for `times` repetitions,
+ * repetition k (from 0) being shifted by k * shift cycles. Entries after them are written with their real cycles.
+ */
+struct TracePeriod {
+    size_t  start = 0;  ///< Index of the first entry of the period in the compressed trace.
+    size_t  length = 0; ///< Number of entries in one period.
+    long    shift = 0;  ///< Cycles between two repetitions.
+    long    times = 0;  ///< Number of repetitions, the trace is not compressed if lower than 2.
+
+    bool active() const noexcept { return times > 1 && length > 0; } ///< Whether the trace is compressed.
+};
+
+/**
+ * @brief Find the periodic part of a trace that saves the most entries.
+ *
+ * Tries every period length up to max_length and keeps the longest run where entry i + length is entry i
+ * shifted by a constant (positive) number of cycles.
+ *
+ * @param trace The expanded trace.
+ * @param max_length Maximum number of entries in a period.
+ * @return The period (not active if none saves entries).
+ */
+TracePeriod find_trace_period(const std::vector<TraceEntry> &trace, size_t max_length = 256);
+
+/**
+ * @brief Remove the repetitions of the period from an expanded trace, keeping one.
+ */
+void compress_trace(std::vector<TraceEntry> &trace, const TracePeriod &period);
+
+/**
+ * @brief Expand a compressed trace, writing every repetition of the period.
+ */
+std::vector<TraceEntry> expand_trace(const std::vector<TraceEntry> &trace, const TracePeriod &period);
+
+/**
+ * @brief Buffered, allocation-free writer for traces.
+ *
+ * Integers are formatted with std::to_chars straight into a large buffer, which is written to the
+ * file descriptor in big chunks with write(2). Nothing goes through iostreams, so std::cout has to be
+ * flushed before writing to the standard output with this writer.
+ */
+class TraceWriter {
+public:
+    /**
+     * @brief Write to an already open file descriptor (not closed by the writer).
+     * @param fd The file descriptor, typically STDOUT_FILENO.
+     * @param buffer_size Size of the output buffer.
+     */
+    explicit TraceWriter(int fd, size_t buffer_size = 1 << 20);
+
+    /**
+     * @brief Create (or truncate) a file and write to it.
+     * @param path The path of the file.
+     * @param buffer_size Size of the output buffer.
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    explicit TraceWriter(const std::string &path, size_t buffer_size = 1 << 20);
+
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    void write(std::string_view text);  ///< Append raw text.
+    void write(long value);             ///< Append an integer in decimal.
+    void put(char c);                   ///< Append a single character.
+
+    /**
+     * @brief Append a trace line `<cycle>:<name>\n`.
+     */
+    void write_entry(long cycle, std::string_view name);
+
+    /**
+     * @brief Append a repeat directive line `@repeat:<length>:<shift>:<times>\n`.
+     */
+    void write_repeat(const TracePeriod &period);
+
+    /**
+     * @brief Write the buffered bytes to the file descriptor.
+     * @throws std::runtime_error if the write fails.
+     */
+    void flush();
+
+private:
+    void reserve(size_t bytes);
+
+    int                 fd_;
+    bool                owns_fd_;
+    std::vector<char>   buffer_;
+    size_t              used_ = 0;
+};
+
+///< @brief Magic bytes at the start of a binary trace.
+constexpr char BINARY_TRACE_MAGIC[4] = {'K', 'R', 'P', 'T'};
+///< @brief Version of the binary trace format.
+constexpr uint8_t BINARY_TRACE_VERSION = 2;
+
+///< @brief Header of a binary trace.
+struct BinaryTraceHeader {
+    uint64_t    config_hash = 0;    ///< Hash of the configuration the trace was produced for.
+    uint32_t    process_count = 0;  ///< Number of processes declared in the configuration.
+    uint64_t    entry_count = 0;    ///< Number of launch entries.
+};
+
+
+/**
+ * @brief Encodes launch entries in the binary trace format.
+ *
+ * Entries are encoded in memory, the header (which holds the entry count) and the body are written by write().
+ */
+class BinaryTraceEncoder {
+public:
+    /**
+     * @param process_count Number of processes declared in the configuration (also the repeat escape ID).
+     */
+    explicit BinaryTraceEncoder(uint32_t process_count) : process_count_(process_count) {}
+
+    /**
+     * @brief Append a launch entry.
+     * @param cycle The launch cycle.
+     * @param pid The process ID (index of the process in the configuration file).
+     */
+    void add(long cycle, uint32_t pid);
+
+    /**
+     * @brief Append a repeat directive, applying to the `period.length` entries added after it.
+     */
+    void add_repeat(const TracePeriod &period);
+
+    /**
+     * @brief Write the header and the encoded entries.
+     * @param out The writer.
+     * @param config_hash Hash of the configuration.
+     */
+    void write(TraceWriter &out, uint64_t config_hash) const;
+
+    uint64_t size() const noexcept { return count_; } ///< Number of entries added.
+
+private:
+    uint32_t    process_count_;
+    std::string body_;
+    long        prev_cycle_ = 0;
+    uint64_t    count_ = 0;
+};
+
+
+/**
+ * @brief Streaming decoder of a binary trace read from a file.
+ */
+class BinaryTraceReader {
+public:
+    /**
+     * @brief Read and check the header.
+     * @param file The trace file, positioned at its start.
+     * @throws std::runtime_error if the header is not a valid binary trace header.
+     */
+    explicit BinaryTraceReader(std::FILE *file);
+
+    const BinaryTraceHeader &header() const noexcept { return header_; } ///< Header of the trace.
+
+    /**
+     * @brief Decode the next entry.
+     *
+     * A process ID equal to header().process_count is a repeat directive, available with repeat().
+     *
+     * @return false once every entry announced by the header has been read.
+     * @throws std::runtime_error if the trace is truncated or malformed.
+     */
+    bool next(long &cycle, uint32_t &pid);
+
+    const TracePeriod &repeat() const noexcept { return repeat_; } ///< Last repeat directive read.
+
+private:
+    bool        fill();
+    uint64_t    read_varint();
+
+    std::FILE           *file_;
+    std::vector<char>   buffer_;
+    size_t              begin_ = 0;
+    size_t              end_ = 0;
+    BinaryTraceHeader   header_;
+    uint64_t            read_ = 0;
+    long                cycle_ = 0;
+    TracePeriod         repeat_;
+};
+
+/**
+ * @brief Check whether a file starts with the binary trace magic, then rewind it.
+ */
+bool is_binary_trace(std::FILE *file);
+
+#endif
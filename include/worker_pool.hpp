@@ -0,0 +1,61 @@
+/*!
+ *  @file worker_pool.hpp
+ *  @brief Header file for the pool of threads used by the krpsim solvers
+ *
+ *  The solvers run many small parallel rounds (one per beam depth for instance), so threads are started once
+ *  and woken up for each round instead of being created every time.
+ */
+
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of threads running rounds of independent tasks.
+ *
+ * The calling thread takes part in each round as worker 0, so a pool of one worker starts no thread.
+ */
+class WorkerPool {
+public:
+    /**
+     * @param worker_count Number of workers including the calling thread, 0 for all cores.
+     */
+    explicit WorkerPool(unsigned worker_count);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /**
+     * @brief Run task(index, worker) for every index in [0, task_count), and wait for all of them.
+     *
+     * Indexes are handed out one at a time, worker is in [0, size()) and identifies the thread running the task.
+     */
+    void run(size_t task_count, const std::function<void(size_t, unsigned)> &task);
+
+    unsigned size() const noexcept { return static_cast<unsigned>(threads_.size()) + 1; } ///< Number of workers.
+
+private:
+    void work(unsigned worker);
+    void drain(unsigned worker);
+
+    std::vector<std::thread>                        threads_;
+    std::mutex                                      mutex_;
+    std::condition_variable                         start_;         ///< Signals a new round or the shutdown
+    std::condition_variable                         done_;          ///< Signals the end of a round
+    const std::function<void(size_t, unsigned)>*    task_ = nullptr;
+    size_t                                          task_count_ = 0;
+    std::atomic<size_t>                             next_{0};       ///< Next task index to hand out
+    unsigned                                        busy_ = 0;      ///< Helper threads still in the round
+    unsigned long                                   round_ = 0;
+    bool                                            stop_ = false;
+};
+
+#endif
@@ -0,0 +1,214 @@
+/*!
+ *  @file beam_search.cpp
+ *  @brief Implementation of the beam search solver of krpsim
+ *
+ *  Beam states do not carry their trace: each kept launch is stored once in an arena of links to the previous
+ *  launch, and the trace of the best state is rebuilt from its last link at the end of the search.
+ */
+
+#include "beam_search.hpp"
+#include "worker_pool.hpp"
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+///< @brief Launch kept in the beam, chained to the previous launch of the same state.
+struct TraceLink {
+    int parent;     ///< index of the previous launch in the arena, -1 for none
+    int proc_id;    ///< launched process
+    int count;      ///< number of copies
+    int cycle;      ///< launch cycle
+};
+
+///< @brief State of the beam.
+struct BeamState {
+    Candidate           candidate;          ///< simulation state, its trace stays empty (see link)
+    RunnableSet         set;                ///< launchable processes of the state
+    std::vector<int>    projected;          ///< stocks once all running processes finish
+    int                 link = -1;          ///< last launch leading to this state in the arena
+    int                 score = 0;          ///< score of the projected stocks
+    uint64_t            hash = 0;           ///< hash of the cycle, stocks and running processes
+    int                 launch_pid = -1;    ///< launch made by the step leading to this state, -1 for a wait
+    int                 launch_count = 0;   ///< number of copies of that launch
+    int                 launches = 0;       ///< number of launches since the start
+};
+
+bool is_terminal(const BeamState &state, const BeamParameters &params) {
+    const std::vector<int> &runnable = state.set.runnable;
+    return state.candidate.cycle >= params.maxCycles
+        || ((runnable.empty() || (runnable.size() == 1 && runnable[0] == -1)) && state.candidate.running.empty());
+}
+
+/**
+ * @brief Score of projected stocks, each stock credited up to its cap.
+ *
+ * Without caps, a process multiplying a far item (e.g. 1 knowledge into 20 mental_sanity) always scores better than
+ * the processes converting it towards the target, and the beam would only hoard.
+ */
+int capped_score(const std::vector<int> &projected, int cycle, const Config &cfg, const std::vector<int> &caps) {
+    thread_local std::vector<int> capped;
+    capped.resize(projected.size());
+    for (size_t id = 0; id < projected.size(); ++id)
+        capped[id] = caps[id] < 0 ? projected[id] : std::min(projected[id], caps[id]);
+    return score_stocks(capped, cycle, cfg);
+}
+
+void finish_step(BeamState &child, const Config &cfg, const std::vector<int> &caps) {
+    restore_parked(child.set);
+    delete_high_stock_processes(child.set, cfg, child.candidate);
+    child.score = capped_score(child.projected, child.candidate.cycle, cfg, caps);
+    child.hash = mix(state_hash(child.candidate) ^ static_cast<uint64_t>(child.candidate.cycle));
+}
+
+/**
+ * @brief Children of a state: wait, and launch one or all possible copies of each launchable process.
+ */
+void expand(const BeamState &state, const Config &cfg, const BeamParameters &params, const std::vector<int> &caps,
+            std::vector<BeamState> &children) {
+    const ProcessTable &table = cfg.table;
+    for (int pid : state.set.runnable) {
+        if (pid == -1) {
+            if (state.candidate.running.empty())
+                continue;
+            BeamState child = state;
+            wait_next_finish(child.candidate, cfg, child.set);
+            child.launch_pid = -1;
+            finish_step(child, cfg, caps);
+            children.push_back(std::move(child));
+            continue;
+        }
+
+        // Keep the projected stocks representable and the trace within its budget
+        long limit = std::min(max_launches(state.candidate, cfg, pid), params.maxLaunches - state.launches);
+        for (int k = table.result_offsets[pid]; k < table.result_offsets[pid + 1]; ++k) {
+            if (table.result_qty[k] > 0)
+                limit = std::min(limit, (INT_MAX - static_cast<long>(state.projected[table.result_item[k]])) / table.result_qty[k]);
+        }
+        const int max_count = static_cast<int>(limit);
+        if (max_count < 1)
+            continue;
+        const int counts[] = {1, max_count};
+        for (int c = 0; c < (max_count > 1 ? 2 : 1); ++c) {
+            const int count = counts[c];
+            BeamState child = state;
+            apply_launches(child.candidate, cfg, pid, count, child.set, false);
+            for (int k = table.need_offsets[pid]; k < table.need_offsets[pid + 1]; ++k)
+                child.projected[table.need_item[k]] -= table.need_qty[k] * count;
+            for (int k = table.result_offsets[pid]; k < table.result_offsets[pid + 1]; ++k)
+                child.projected[table.result_item[k]] += table.result_qty[k] * count;
+            child.launch_pid = pid;
+            child.launch_count = count;
+            child.launches += count;
+            finish_step(child, cfg, caps);
+            children.push_back(std::move(child));
+        }
+    }
+}
+
+bool better(const BeamState &a, const BeamState &b) {
+    if (a.score != b.score)
+        return a.score > b.score;
+    return a.candidate.cycle > b.candidate.cycle; // on a tie, waiting moves the search forward
+}
+
+} // namespace
+
+
+Candidate solve_with_beam(const Config &cfg, long timeBudgetMs, const BeamParameters &params) {
+    const auto start_time = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&]() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    };
+
+    WorkerPool pool(params.threads);
+
+    // Stocks are credited up to a few launches of their most demanding needer, items nobody needs are not capped
+    std::vector<int> caps(cfg.item_to_id.size(), -1);
+    for (size_t k = 0; k < cfg.table.need_item.size(); ++k) {
+        int &cap = caps[cfg.table.need_item[k]];
+        cap = std::max(cap, static_cast<int>(std::min<long>(INT_MAX, static_cast<long>(cfg.table.need_qty[k]) * params.saturation)));
+    }
+    std::vector<TraceLink> links;
+
+    std::vector<BeamState> beam(1);
+    init_simulation(beam[0].candidate, cfg, beam[0].set);
+    delete_high_stock_processes(beam[0].set, cfg, beam[0].candidate);
+    beam[0].projected = beam[0].candidate.stocks_by_id;
+
+    // Best end state: a beam state whose running processes are left to finish
+    int best_score = score_stocks(beam[0].projected, 0, cfg);
+    int best_cycle = 0;
+    int best_link = -1;
+    std::vector<int> best_stocks = beam[0].projected;
+
+    const int target = target_item(cfg);
+    std::vector<std::vector<BeamState>> children(pool.size());
+    std::vector<BeamState> next;
+    std::unordered_map<uint64_t, size_t> seen;
+    while (!beam.empty() && elapsed_ms() < timeBudgetMs) {
+        for (auto &list : children)
+            list.clear();
+        pool.run(beam.size(), [&](size_t index, unsigned worker) {
+            if (!is_terminal(beam[index], params))
+                expand(beam[index], cfg, params, caps, children[worker]);
+        });
+
+        // Merge children reaching the same state, keeping the best one
+        next.clear();
+        seen.clear();
+        for (auto &list : children) {
+            for (BeamState &child : list) {
+                auto [it, inserted] = seen.emplace(child.hash, next.size());
+                if (inserted)
+                    next.push_back(std::move(child));
+                else if (better(child, next[it->second]))
+                    next[it->second] = std::move(child);
+            }
+        }
+        const size_t width = std::min(next.size(), static_cast<size_t>(std::max(params.width, 1)));
+        std::partial_sort(next.begin(), next.begin() + static_cast<long>(width), next.end(), better);
+        next.resize(width);
+
+        for (BeamState &state : next) {
+            if (state.launch_pid != -1) {
+                links.push_back({state.link, state.launch_pid, state.launch_count, state.candidate.cycle});
+                state.link = static_cast<int>(links.size()) - 1;
+                state.launch_pid = -1;
+            }
+            int finish = state.candidate.cycle;
+            for (const RunningProcess &rp : running_entries(state.candidate.running))
+                finish = std::max(finish, rp.finish);
+            const int score = score_stocks(state.projected, finish, cfg);
+            if (score > best_score || (score == best_score && finish < best_cycle)) {
+                best_score = score;
+                best_cycle = finish;
+                best_link = state.link;
+                best_stocks = state.projected;
+            }
+        }
+        beam.swap(next);
+        if (target >= 0 && best_stocks[target] >= params.goal)
+            break; // no state can produce more of the target
+    }
+
+    // Rebuild the trace of the best state, its running processes finish before its last cycle
+    Candidate best;
+    best.cycle = best_cycle;
+    best.stocks_by_id = std::move(best_stocks);
+    std::vector<int> chain;
+    for (int link = best_link; link != -1; link = links[link].parent)
+        chain.push_back(link);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        const TraceLink &link = links[*it];
+        best.trace.insert(best.trace.end(), static_cast<size_t>(link.count), TraceEntry{link.cycle, link.proc_id});
+    }
+    return best;
+}
@@ -0,0 +1,174 @@
+/*!
+ *  @file bounds.cpp
+ *  @brief Implementation of the upper bounds on the optimization target of krpsim
+ */
+
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+constexpr double EPSILON = 1e-9;
+constexpr size_t MAX_TABLEAU_SIZE = size_t{1} << 22;   ///< Cells of the simplex tableau, larger relaxations are not solved
+constexpr size_t MAX_HISTORY_SIZE = size_t{1} << 24;   ///< Launch counts kept by the horizon bound
+
+/**
+ * @brief Maximize c.x subject to A x <= b, x >= 0, with b >= 0 so that x = 0 is feasible.
+ *
+ * Dense tableau with Bland's rule, which cannot cycle on degenerate pivots.
+ *
+ * @param tableau Rows of A with their slack and b, then the row of -c, each row has cols cells.
+ * @return The optimum, infinite if unbounded or if the iterations run out.
+ */
+double simplex(std::vector<double> &tableau, size_t rows, size_t cols) {
+    const size_t m = rows - 1;
+    std::vector<size_t> basis(m);
+    for (size_t i = 0; i < m; ++i)
+        basis[i] = cols - 1 - m + i;
+    double *objective = &tableau[m * cols];
+
+    const size_t max_iterations = 10000 + 20 * cols;
+    for (size_t iteration = 0; iteration < max_iterations; ++iteration) {
+        size_t enter = cols;
+        for (size_t j = 0; j + 1 < cols; ++j) {
+            if (objective[j] < -EPSILON) {
+                enter = j;
+                break;
+            }
+        }
+        if (enter == cols)
+            return objective[cols - 1];
+
+        size_t leave = m;
+        double best_ratio = INF;
+        for (size_t i = 0; i < m; ++i) {
+            const double a = tableau[i * cols + enter];
+            if (a <= EPSILON)
+                continue;
+            const double ratio = tableau[i * cols + cols - 1] / a;
+            if (ratio < best_ratio - EPSILON || (ratio <= best_ratio + EPSILON && leave < m && basis[i] < basis[leave])) {
+                best_ratio = ratio;
+                leave = i;
+            }
+        }
+        if (leave == m)
+            return INF; // the entering launch count can grow forever
+
+        double *pivot_row = &tableau[leave * cols];
+        const double pivot = pivot_row[enter];
+        for (size_t j = 0; j < cols; ++j)
+            pivot_row[j] /= pivot;
+        for (size_t i = 0; i < rows; ++i) {
+            if (i == leave)
+                continue;
+            double *row = &tableau[i * cols];
+            const double factor = row[enter];
+            if (factor == 0.0)
+                continue;
+            for (size_t j = 0; j < cols; ++j)
+                row[j] -= factor * pivot_row[j];
+        }
+        basis[leave] = enter;
+    }
+    return INF;
+}
+
+} // namespace
+
+
+int target_item(const Config &cfg) {
+    for (const std::string &key : cfg.optimizeKeys) {
+        if (key != "time") {
+            auto it = cfg.item_to_id.find(key);
+            return it == cfg.item_to_id.end() ? -1 : it->second;
+        }
+    }
+    return -1;
+}
+
+
+double lp_target_bound(const Config &cfg, const std::vector<int> &available) {
+    const int target = target_item(cfg);
+    if (target < 0)
+        return INF;
+    const ProcessTable &table = cfg.table;
+    const size_t n = table.delay.size();
+    const size_t m = available.size();
+    const size_t rows = m + 1;
+    const size_t cols = n + m + 1;
+    if (rows * cols > MAX_TABLEAU_SIZE)
+        return INF;
+
+    // One row per item: (needs - results) x + slack = available, the objective row holds -(net target production)
+    std::vector<double> tableau(rows * cols, 0.0);
+    for (size_t p = 0; p < n; ++p) {
+        for (int k = table.need_offsets[p]; k < table.need_offsets[p + 1]; ++k)
+            tableau[table.need_item[k] * cols + p] += table.need_qty[k];
+        for (int k = table.result_offsets[p]; k < table.result_offsets[p + 1]; ++k)
+            tableau[table.result_item[k] * cols + p] -= table.result_qty[k];
+        tableau[m * cols + p] = tableau[target * cols + p];
+    }
+    for (size_t i = 0; i < m; ++i) {
+        tableau[i * cols + n + i] = 1.0;
+        tableau[i * cols + cols - 1] = std::max(available[i], 0);
+    }
+    return available[target] + simplex(tableau, rows, cols);
+}
+
+
+double horizon_target_bound(const Config &cfg, const std::vector<int> &available, int horizon) {
+    const int target = target_item(cfg);
+    const ProcessTable &table = cfg.table;
+    const size_t process_count = table.delay.size();
+    if (target < 0 || horizon < 0)
+        return INF;
+    int max_delay = 0;
+    for (int delay : table.delay) {
+        if (delay <= 0)
+            return INF; // results available at launch, the bound would need a fixed point
+        max_delay = std::max(max_delay, delay);
+    }
+    const size_t launch_cycles = static_cast<size_t>(horizon) + 1;
+    if (process_count * launch_cycles > MAX_HISTORY_SIZE)
+        return INF;
+
+    // launches[p * launch_cycles + s]: bound on the launches of p started at or before s
+    std::vector<double> launches(process_count * launch_cycles, 0.0);
+    std::vector<double> availability(available.size());
+    const long last_cycle = static_cast<long>(horizon) + max_delay;
+    for (long t = 0; t <= last_cycle; ++t) {
+        for (size_t i = 0; i < available.size(); ++i)
+            availability[i] = available[i];
+        for (size_t p = 0; p < process_count; ++p) {
+            const long started = std::min(t - table.delay[p], static_cast<long>(horizon));
+            if (started < 0)
+                continue;
+            const double count = launches[p * launch_cycles + static_cast<size_t>(started)];
+            for (int k = table.result_offsets[p]; k < table.result_offsets[p + 1]; ++k)
+                availability[table.result_item[k]] += table.result_qty[k] * count;
+        }
+        if (std::isinf(availability[target]))
+            return INF;
+        if (t > horizon)
+            continue;
+        for (size_t p = 0; p < process_count; ++p) {
+            double count = INF;
+            for (int k = table.need_offsets[p]; k < table.need_offsets[p + 1]; ++k)
+                count = std::min(count, std::floor(availability[table.need_item[k]] / table.need_qty[k]));
+            launches[p * launch_cycles + static_cast<size_t>(t)] = count;
+        }
+    }
+    return availability[target];
+}
+
+
+double target_upper_bound(const Config &cfg, const std::vector<int> &available, int horizon) {
+    const double lp = lp_target_bound(cfg, available);
+    const double over_time = horizon_target_bound(cfg, available, horizon);
+    return std::floor(std::min(lp, over_time) + 1e-6); // the target is an integer
+}
@@ -0,0 +1,235 @@
+/*!
+ *  @file exact.cpp
+ *  @brief Implementation of the exact branch-and-bound solver of krpsim
+ *
+ *  States do not carry their trace: each launch is a link to the previous one, shared by all the states below it,
+ *  and the trace is rebuilt when a state beats the incumbent.
+ */
+
+#include "exact.hpp"
+#include "bounds.hpp"
+#include "greedy.hpp"
+#include "state_table.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+constexpr long   TIME_CHECK_STEPS = 256;        ///< States expanded by a thread between two checks of the time budget
+constexpr long   HORIZON_BOUND_CELLS = 1 << 12; ///< Largest process count times horizon for which the horizon bound is computed
+
+///< @brief Launch of k copies of a process, chained to the previous launch of the schedule.
+struct Link {
+    std::shared_ptr<const Link> parent;     ///< previous launch, null for the first one
+    int                         cycle;      ///< launch cycle
+    int                         proc_id;    ///< launched process
+    int                         count;      ///< number of copies
+};
+
+///< @brief State of the search.
+struct Node {
+    Candidate                   candidate;  ///< simulation state, its trace stays empty (see link)
+    RunnableSet                 set;        ///< launchable processes of the state
+    std::shared_ptr<const Link> link;       ///< last launch leading to this state
+    int                         min_pid = 0;///< processes launched at this cycle from now on have at least this ID
+};
+
+uint64_t node_hash(const Node &node) {
+    return mix(state_hash(node.candidate) ^ static_cast<uint64_t>(node.min_pid));
+}
+
+///< @brief Stack of states of a thread, other threads steal from its bottom.
+struct WorkQueue {
+    std::mutex          mutex;
+    std::deque<Node>    nodes;
+};
+
+class ExactSearch {
+public:
+    ExactSearch(const Config &cfg, const ExactParameters &params, unsigned workers, Candidate incumbent)
+        : cfg_(cfg), params_(params), target_(target_item(cfg)), seen_(params.maxStates), queues_(workers),
+          best_(std::move(incumbent)) {
+        best_target_ = target_ >= 0 ? best_.stocks_by_id[target_] : 0;
+        best_cycle_ = best_.cycle;
+    }
+
+    /**
+     * @brief Explore the states of the queue of worker, and steal when it runs out, until every state is explored.
+     *
+     * @return False if the deadline stopped the search.
+     */
+    bool work(unsigned worker, std::chrono::steady_clock::time_point deadline) {
+        Node node;
+        for (long steps = 1; !timed_out_.load(std::memory_order_relaxed); ++steps) {
+            if (!pop(worker, node) && !steal(worker, node)) {
+                if (pending_.load() == 0)
+                    break;
+                std::this_thread::yield();
+                continue;
+            }
+            expand(node, worker);
+            pending_.fetch_sub(1);
+            if (steps % TIME_CHECK_STEPS == 0 && std::chrono::steady_clock::now() > deadline)
+                timed_out_ = true;
+        }
+        return !timed_out_;
+    }
+
+    void push(unsigned worker, Node node) {
+        pending_.fetch_add(1);
+        std::lock_guard<std::mutex> lock(queues_[worker].mutex);
+        queues_[worker].nodes.push_back(std::move(node));
+    }
+
+    Candidate best() const { return best_; }
+
+private:
+    bool pop(unsigned worker, Node &node) {
+        std::lock_guard<std::mutex> lock(queues_[worker].mutex);
+        if (queues_[worker].nodes.empty())
+            return false;
+        node = std::move(queues_[worker].nodes.back());
+        queues_[worker].nodes.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned worker, Node &node) {
+        for (size_t offset = 1; offset < queues_.size(); ++offset) {
+            WorkQueue &queue = queues_[(worker + offset) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.nodes.empty()) {
+                node = std::move(queue.nodes.front()); // the oldest state roots the largest subtree
+                queue.nodes.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Offer the schedule of a state, its running processes finished, as the incumbent.
+     */
+    void offer(const Node &node, const Candidate &finished) {
+        const long value = target_ >= 0 ? finished.stocks_by_id[target_] : 0;
+        std::lock_guard<std::mutex> lock(best_mutex_);
+        if (value < best_target_ || (value == best_target_ && finished.cycle >= best_cycle_))
+            return;
+        best_ = finished;
+        std::vector<const Link *> links;
+        for (const Link *link = node.link.get(); link; link = link->parent.get())
+            links.push_back(link);
+        for (auto it = links.rbegin(); it != links.rend(); ++it)
+            best_.trace.insert(best_.trace.end(), (*it)->count, TraceEntry{(*it)->cycle, (*it)->proc_id});
+        best_target_ = value;
+        best_cycle_ = finished.cycle;
+    }
+
+    /**
+     * @brief Upper bound on the target of the schedules through a state, from its stocks once its processes finish.
+     */
+    long bound(const std::vector<int> &projected, int cycle) const {
+        if (target_ < 0)
+            return 0;
+        const long horizon = static_cast<long>(params_.maxCycles) - cycle - 1;
+        if (horizon < 0)
+            return projected[target_];
+        const long process_count = static_cast<long>(cfg_.table.delay.size());
+        const double bound = horizon * process_count <= HORIZON_BOUND_CELLS
+            ? target_upper_bound(cfg_, projected, static_cast<int>(horizon))
+            : std::floor(lp_target_bound(cfg_, projected) + 1e-6);
+        return std::isinf(bound) ? LONG_MAX : static_cast<long>(bound);
+    }
+
+    void expand(const Node &node, unsigned worker) {
+        Candidate finished = node.candidate;
+        finish_running(finished, cfg_);
+        offer(node, finished);
+
+        const int cycle = node.candidate.cycle;
+        const long upper = bound(finished.stocks_by_id, cycle);
+        const long best_target = best_target_.load(std::memory_order_relaxed);
+        if (upper < best_target || (upper == best_target && cycle >= best_cycle_.load(std::memory_order_relaxed)))
+            return;
+        if (!seen_.visit(node_hash(node), cycle))
+            return; // explored already, at this cycle or earlier
+
+        if (!node.candidate.running.empty()) {
+            Node child = node;
+            wait_next_finish(child.candidate, cfg_, child.set);
+            child.min_pid = 0;
+            push(worker, std::move(child));
+        }
+        if (cycle >= params_.maxCycles)
+            return;
+
+        std::vector<int> launchable;
+        for (int pid : node.set.runnable) {
+            if (pid >= node.min_pid)
+                launchable.push_back(pid);
+        }
+        std::sort(launchable.begin(), launchable.end());
+        for (int pid : launchable) {
+            const int max_count = max_launches(node.candidate, cfg_, pid);
+            for (int count = 1; count <= max_count; ++count) {
+                Node child = node;
+                apply_launches(child.candidate, cfg_, pid, count, child.set, false);
+                child.link = std::make_shared<const Link>(Link{node.link, cycle, pid, count});
+                child.min_pid = pid + 1;
+                push(worker, std::move(child));
+            }
+        }
+    }
+
+    const Config            &cfg_;
+    const ExactParameters   &params_;
+    const int               target_;
+    StateTable              seen_;              ///< earliest cycle each state was explored at
+    std::vector<WorkQueue>  queues_;
+    std::atomic<long>       pending_{0};        ///< states pushed and not expanded yet
+    std::atomic<bool>       timed_out_{false};
+
+    std::mutex              best_mutex_;
+    Candidate               best_;              ///< incumbent, its running processes finished
+    std::atomic<long>       best_target_{0};    ///< target of the incumbent, read without the lock to prune
+    std::atomic<int>        best_cycle_{0};     ///< cycle of the incumbent
+};
+
+} // namespace
+
+
+Candidate solve_exact(const Config &cfg, long timeBudgetMs, const ExactParameters &params, bool *optimal) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeBudgetMs);
+
+    GreedyParameters greedy;
+    greedy.maxCycles = params.maxCycles;
+    Candidate incumbent = solve_with_greedy(cfg, timeBudgetMs / 10, greedy);
+    incumbent.trace = expand_trace(incumbent.trace, incumbent.period);
+    incumbent.period = TracePeriod{};
+    finish_running(incumbent, cfg);
+
+    WorkerPool pool(params.threads);
+    ExactSearch search(cfg, params, pool.size(), std::move(incumbent));
+    Node root;
+    init_simulation(root.candidate, cfg, root.set);
+    search.push(0, std::move(root));
+
+    std::atomic<bool> complete{true};
+    pool.run(pool.size(), [&](size_t, unsigned worker) {
+        if (!search.work(worker, deadline))
+            complete = false;
+    });
+    if (optimal)
+        *optimal = complete;
+    return search.best();
+}
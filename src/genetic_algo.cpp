@@ -9,191 +9,156 @@
  */
 
 #include "genetic_algo.hpp"
+#include "simulation.hpp"
+#include "bounds.hpp"
+#include "greedy.hpp"
 
 #include <algorithm>
+#include <climits>
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 
-/**
- * @brief Parameters for the genetic algorithm.
- *
- * This struct contains parameters that control the behavior of the genetic algorithm,
- * such as the maximum number of iterations, population size, mutation rate, and weights for the fitness function.
- */
-struct GeneticParameters {
-    int maxIter = 1000;         ///< Maximum number of iterations for the genetic algorithm
-    int populationSize = 100;   ///< Size of the population in the genetic algorithm
-    int maxCycles = 50000;      ///< Maximum number of cycles to run the simulation
-    double mutationRate = 10.0;  ///< Percentage (0-100) of mutation in the genetic algorithm
-    double score_alpha = 1.0;   ///< Weight for the target stock in the fitness function
-    double score_beta = 0.1;    ///< Weight for the other stocks in the fitness function
-    double score_decay = 0.7;   ///< Decay factor for the other
-};
-
-
-/**
- * @brief Function to delete processes that produce items with stocks exceeding configured limits.
- *
- * This function iterates through the runnable list of processes and removes those
- * that produce stocks exceeding the configured limits, based on the candidate's current stock state.
- *
- * @param runnable_list The list of process IDs that are currently runnable.
- * @param is_runnable A vector indicating whether each process is runnable.
- * @param cfg The configuration containing the maximum stock limits.
- * @param candidate The current candidate containing stock information.
- */
-void delete_high_stock_processes(std::vector<int>& runnable_list,
-                                 std::vector<bool>& is_runnable,
-                                 const Config& cfg,
-                                 const Candidate& candidate)
-{
-    if (cfg.maxStocks.limiting_item.empty())
-        return;
-    if (runnable_list.empty() || (runnable_list.size() == 1 && runnable_list[0] == -1)) {
-        return; // nothing to do
+void prepare_policy_step(RunnableSet &set, const Config &cfg, const Candidate &candidate) {
+    std::vector<int> &runnable = set.runnable;
+    int first_cycle_process = -1;
+    for (size_t j = 0; j < runnable.size(); ) {
+        const int pid = runnable[j];
+        if (pid != -1 && cfg.processes[pid].in_cycle == true) {
+            if (first_cycle_process == -1)
+                first_cycle_process = pid;
+            park_process(set, pid); // Remove processes that are in a cycle
+        } else {
+            ++j; // Only increment if we didn't remove an element
+        }
     }
-
-    const int item_count = static_cast<int>(cfg.item_to_id.size());
-    const bool factors_mode = (cfg.maxStocks.limiting_initial_stock == -1);
-    std::vector<bool> over;
-    over.assign(item_count, false);
-
-    // limiting stock for factor caps
-    const int limiting_stock =
-        (cfg.maxStocks.limiting_initial_stock != -1)
-            ? cfg.maxStocks.limiting_initial_stock
-            : (!cfg.maxStocks.limiting_item.empty()
-               ? candidate.stocks_by_id[cfg.item_to_id.at(cfg.maxStocks.limiting_item)]
-               : 0);
-
-    // mark overfull items
-    for (int i = 0; i < item_count; ++i) {
-        const int current_stock = candidate.stocks_by_id[i];
-        const int stock_cap = cfg.maxStocks.abs_cap_by_id[i]; // -1 => no cap
-        const double stock_factor = cfg.maxStocks.factor_by_id[i]; // -1 => no cap
-
-        bool too_much = false;
-        if (!factors_mode && stock_cap >= 0 && current_stock > stock_cap)
-            too_much = true;
-        if (factors_mode && stock_factor >= 0.0 && current_stock > limiting_stock * stock_factor)
-            too_much = true;
-        over[i] = too_much;
+    if (first_cycle_process != -1 && (runnable.empty() || (runnable.size() == 1 && runnable[0] == -1 && candidate.running.empty()))) {
+        runnable.push_back(first_cycle_process); // Re-add the first cycle process to the end of the runnable list
+        set.is_runnable[first_cycle_process] = true; // Mark it as runnable again
     }
+}
 
-    // helper lambda to check if a process can be dropped
-    auto drop = [&](int pid) {
-        if (pid < 0)
-            return false; // keep wait sentinel
-        const Process& p = cfg.processes[pid];
-        if (p.results_by_id.empty())
-            return false;
-        for (auto [id, _] : p.results_by_id)
-            if (!over[id])
-                return false;
-        return true;
-    };
 
-    // drop processes for which all results are overfull
-    int non_wait_runnable = -1;
-    for (auto it = runnable_list.begin(); it != runnable_list.end();) {
-        if (*it < 0) {
-            ++it; // skip wait sentinel
-            continue;
-        }
-        if (non_wait_runnable == -1 && is_runnable[*it]) {
-            non_wait_runnable = *it; // remember the first runnable process
-        }
-        if (drop(*it)) {
-            is_runnable[*it] = false; // mark as not runnable
-            it = runnable_list.erase(it); // remove from runnable list
-        } else {
-            ++it; // keep in runnable list
-        }
-    }
+bool simulation_over(const Candidate &candidate, const RunnableSet &set, int maxCycles) {
+    const std::vector<int> &runnable = set.runnable;
+    return candidate.cycle >= maxCycles
+        || ((runnable.empty() || (runnable.size() == 1 && runnable[0] == -1)) && candidate.running.empty());
+}
 
-    // if we have no running processes and no runnable processes, we can add back the first non-wait runnable process
-    if (candidate.running.empty() && non_wait_runnable != -1 && (runnable_list.empty() || (runnable_list.size() == 1 && runnable_list[0] == -1))) {
-        if (!is_runnable[non_wait_runnable]) {
-            is_runnable[non_wait_runnable] = true; // mark as runnable
-            runnable_list.push_back(non_wait_runnable);
+
+std::vector<double> mutation_weights(const Config &cfg, double decay) {
+    const ProcessTable &table = cfg.table;
+    double farthest = 0.0;
+    for (const auto &[name, dist] : cfg.dist)
+        farthest = std::max(farthest, dist);
+    std::vector<double> weights(table.delay.size());
+    for (size_t p = 0; p < weights.size(); ++p) {
+        double rank = farthest + 1.0;
+        for (int k = table.result_offsets[p]; k < table.result_offsets[p + 1]; ++k) {
+            auto it = cfg.dist.find(cfg.id_to_item[table.result_item[k]]);
+            if (it != cfg.dist.end())
+                rank = std::min(rank, it->second);
         }
+        weights[p] = std::pow(decay, rank);
     }
-
+    return weights;
 }
 
 
 /**
- * @brief Function to apply a process to the candidate.
+ * @brief Function to draw a random step: a launchable process or the wait (-1).
  *
- * @param candidate The candidate to modify.
- * @param cfg The configuration containing the processes.
- * @param proc_id The ID of the process to apply, or -1 to wait for the next running process.
- * @param missing A vector tracking how many required items each process is missing.
- * @param runnable A vector of process IDs that are currently runnable.
- * @param is_runnable A vector indicating whether each process is runnable.
+ * With weights, the wait weighs the mean weight of the launchable processes, so it is drawn as often as with
+ * uniform steps.
  */
-void apply_process(Candidate &candidate, const Config& cfg, int proc_id, std::vector<int>& missing, std::vector<int>& runnable, std::vector<bool>& is_runnable) {
-    // Helpers
-    auto add_runnable = [&](int pid) {
-        if (!is_runnable[pid] && missing[pid] == 0) {
-            is_runnable[pid] = true; // mark as runnable
-            runnable.push_back(pid);
-        }
-    };
-    auto remove_runnable = [&](int pid) {
-        if (is_runnable[pid]) {
-            is_runnable[pid] = false;
-            runnable.erase(std::remove(runnable.begin(), runnable.end(), pid), runnable.end());
-        }
-    };
-    auto on_stock_increase = [&](int item_id, int old_val, int new_val) {
-        if (new_val <= old_val) return;
-        for (auto [pid, need_q] : cfg.needers_by_item[item_id]) {
-            if (old_val < need_q && new_val >= need_q) {
-                if (--missing[pid] == 0)
-                    add_runnable(pid);
-            }
+int random_step(const RunnableSet &set, const std::vector<double> *weights, PolicyRandom &random) {
+    const std::vector<int> &runnable = set.runnable;
+    if (!weights)
+        return runnable[random() % runnable.size()];
+    double total = 0.0;
+    int processes = 0;
+    for (int pid : runnable) {
+        if (pid != -1) {
+            total += (*weights)[pid];
+            ++processes;
         }
+    }
+    const double wait = processes > 0 ? total / processes : 1.0;
+    double draw = std::uniform_real_distribution<double>(0.0, total + wait)(random);
+    for (int pid : runnable) {
+        if (pid != -1 && (draw -= (*weights)[pid]) < 0.0)
+            return pid;
+    }
+    return -1;
+}
+
+
+void run_policy(Candidate &child, RunnableSet &set, const Config &cfg, int maxCycles, const PolicyMutation &mutation,
+                PolicyRandom &random, const Candidate *parent1, const Candidate *parent2, int position) {
+    SteadyStateDetector steady_state;
+
+    int i = position;
+
+    const int parent1_size = parent1 ? static_cast<int>(parent1->trace.size()) : 0;
+    const int parent2_size = parent2 ? static_cast<int>(parent2->trace.size()) : 0;
+
+    // Number of copies of the launch at position i of a parent trace, launched together at the same cycle
+    auto parent_run = [](const Candidate &parent, int pos) {
+        const std::vector<TraceEntry> &trace = parent.trace;
+        size_t end = static_cast<size_t>(pos) + 1;
+        while (end < trace.size() && trace[end].procId == trace[pos].procId && trace[end].cycle == trace[pos].cycle)
+            ++end;
+        return static_cast<int>(end - static_cast<size_t>(pos));
     };
-    auto on_stock_decrease = [&](int item_id, int old_val, int new_val) {
-        if (new_val >= old_val) return;
-        for (auto [pid, need_q] : cfg.needers_by_item[item_id]) {
-            if (old_val >= need_q && new_val < need_q) {
-                if (missing[pid]++ == 0)
-                    remove_runnable(pid);
-            }
+
+    while (!simulation_over(child, set, maxCycles)) {
+        prepare_policy_step(set, cfg, child);
+
+        int random_choice = random() % 100; // Randomly choose between parent1 action, parent2 action and mutation
+        int proc_id;
+        int count;
+        // Inside the block of a block mutation, every step is random
+        const bool in_block = child.trace.size() >= mutation.block_begin && child.trace.size() < mutation.block_end;
+
+        // parent1->trace[i].procId in runnable_list
+        if (in_block) {
+            proc_id = random_step(set, mutation.weights, random);
+            count = 1;
+        } else if (i < parent1_size // Check if i is within bounds
+            && set.is_runnable[parent1->trace[i].procId]
+            && random_choice < 100 - mutation.rate / 2) // check if we should use parent1
+        {
+            proc_id = parent1->trace[i].procId;
+            count = parent_run(*parent1, i);
+        } else if (i < parent2_size
+            && set.is_runnable[parent2->trace[i].procId]
+            && !(random_choice > 100 - mutation.rate / 2))
+        {
+            proc_id = parent2->trace[i].procId;
+            count = parent_run(*parent2, i);
+        } else { // mutate means random choice in runnable processes. Mutate if random_choice is greater than 100 - mutationRate or if parent_1 and parent_2 process at i are not runnable
+            proc_id = random_step(set, mutation.weights, random);
+            count = 1; // a single copy, the number of copies then follows from how often the process is drawn
         }
-    };
 
-    if (proc_id == -1) {
-        // If -1 is selected, just wait for the next running process to finish
-        if (!candidate.running.empty()) {
-            candidate.cycle = candidate.running.top().finish;
-            while (!candidate.running.empty() && candidate.running.top().finish <= candidate.cycle) {
-                const int pid = candidate.running.top().id;
-                candidate.running.pop();
-                for(const auto &[id, qty] : cfg.processes[pid].results_by_id) {
-                    const int before = candidate.stocks_by_id[id];
-                    candidate.stocks_by_id[id] += qty;
-                    on_stock_increase(id, before, candidate.stocks_by_id[id]);
-                }
-            }
+        if (proc_id == -1) {
+            if (wait_and_detect_steady_state(child, cfg, set, steady_state, maxCycles))
+                break;
+            ++i;
+        } else {
+            // All copies start in one step, as many as the parent launched together at this cycle and the stocks allow.
+            // The position moves past the whole run of the parent, so that both traces stay aligned.
+            apply_launches(child, cfg, proc_id, std::min(count, max_launches(child, cfg, proc_id)), set);
+            i += count;
         }
-        return;
-    }
-    const Process &proc = cfg.processes[proc_id];
-
-    // Launch the process
-    candidate.running.emplace(candidate.cycle + proc.delay, proc_id);
-    for (auto [id, qty] : proc.needs_by_id) {
-        const int before = candidate.stocks_by_id[id];
-        candidate.stocks_by_id[id] -= qty;
-        on_stock_decrease(id, before, candidate.stocks_by_id[id]);
-    }
-    candidate.trace.push_back({candidate.cycle, proc_id});
 
+        restore_parked(set);
+        delete_high_stock_processes(set, cfg, child);
+    }
 }
 
 
@@ -202,102 +167,105 @@ void apply_process(Candidate &candidate, const Config& cfg, int proc_id, std::ve
  *
  * @param cfg The configuration containing the processes and initial stocks.
  * @param params The genetic parameters for the algorithm.
+ * @param mutation The random steps of the child.
+ * @param random The random source of the policy.
  * @param parent1 The first parent candidate.
  * @param parent2 The second parent candidate.
  * @return A new child candidate generated from the parents.
  */
-Candidate generate_child(const Config &cfg, const GeneticParameters &params, std::optional<Candidate> parent1 = std::nullopt, std::optional<Candidate> parent2 = std::nullopt) {
+Candidate generate_child(const Config &cfg, const GeneticParameters &params, const PolicyMutation &mutation, PolicyRandom &random, std::optional<Candidate> parent1 = std::nullopt, std::optional<Candidate> parent2 = std::nullopt) {
     Candidate child;
-    child.cycle = 0;
-    child.stocks_by_id.assign(cfg.item_to_id.size(), 0);
-    for (auto& [name, qty] : cfg.initialStocks)
-        child.stocks_by_id[cfg.item_to_id.at(name)] = qty;
-    child.trace.clear();
-    child.running = RunPQ();
-
-    const int process_count = static_cast<int>(cfg.processes.size());
-    std::vector<int> missing;
-    std::vector<int> runnable;
-    std::vector<bool> is_runnable; // keep track of processes in runnable list
-
-    missing.assign(process_count, 0);
-    is_runnable.assign(process_count, false);
-    runnable.clear();
-    runnable.reserve(process_count + 1); // +1 for the special -1 ID for waiting next running processes
-
-    for (int pid = 0; pid < process_count; ++pid) {
-        const auto& proc = cfg.processes[pid];
-        for (auto [id, qty] : proc.needs_by_id)
-            if (child.stocks_by_id[id] < qty)
-                ++missing[pid];
-        if (missing[pid] == 0) {
-            runnable.push_back(pid);
-            is_runnable[pid] = true; // mark as runnable
-        }
-    }
-    runnable.push_back(-1); // wait
-    delete_high_stock_processes(runnable, is_runnable, cfg, child);
-
-    int i = 0;
-
-    int parent1_size = 0;
-    int parent2_size = 0;
-    if (parent1.has_value()) {
-        parent1_size = static_cast<int>(parent1.value().trace.size());
-    }
-    if (parent2.has_value()) {
-        parent2_size = static_cast<int>(parent2.value().trace.size());
-    }
+    RunnableSet set;
+    init_simulation(child, cfg, set);
+    delete_high_stock_processes(set, cfg, child);
+    run_policy(child, set, cfg, params.maxCycles, mutation, random,
+               parent1 ? &*parent1 : nullptr, parent2 ? &*parent2 : nullptr);
+    return child;
+}
 
-    while (child.cycle < params.maxCycles) {
-        if ((runnable.empty() || (runnable.size() == 1 && runnable[0] == -1)) && child.running.empty()) {
-            break; // No more runnable or running processes, exit the loop
-        }
 
-        int first_cycle_process = -1;
-        for (auto it = runnable.begin(); it != runnable.end(); ) {
-            if (*it != -1 && cfg.processes[*it].in_cycle == true) {
-                if (first_cycle_process == -1)
-                    first_cycle_process = *it;
-                is_runnable[*it] = false;
-                runnable.erase(it); // Remove processes that are in a cycle
+/**
+ * @brief Function to simulate a child inheriting the launches of its parents on both sides of a random cut cycle.
+ *
+ * Before the cut, the child launches the launches of parent1 once the cycle of the child reaches theirs. After it,
+ * the launches of parent2 from the cut on, the same way for Crossover::Cycle, or one after the other whatever their
+ * cycle for Crossover::Subsequence, the child waiting until the next one can be launched. A launch that cannot be
+ * made is dropped. When no launch is due, the child waits, or takes a random step if nothing runs. Like run_policy,
+ * a share of the steps are random (see PolicyMutation), and the simulation stops early at a steady state.
+ *
+ * @param trace1 The expanded trace of the first parent, sorted by cycle.
+ * @param trace2 The expanded trace of the second parent, sorted by cycle.
+ */
+void run_crossover(Candidate &child, RunnableSet &set, const Config &cfg, const GeneticParameters &params,
+                   const PolicyMutation &mutation, PolicyRandom &random,
+                   const std::vector<TraceEntry> &trace1, const std::vector<TraceEntry> &trace2) {
+    SteadyStateDetector steady_state;
+
+    // The cut is drawn among the cycles of parent1, so that both parents give launches
+    const long last_cycle = trace1.empty() ? 0 : trace1.back().cycle;
+    const long cut = static_cast<long>(random() % static_cast<PolicyRandom::result_type>(last_cycle + 1));
+    size_t next1 = 0;
+    size_t next2 = std::lower_bound(trace2.begin(), trace2.end(), cut,
+                                    [](const TraceEntry &entry, long cycle) { return entry.cycle < cycle; }) - trace2.begin();
+
+    while (!simulation_over(child, set, params.maxCycles)) {
+        prepare_policy_step(set, cfg, child);
+
+        const bool before_cut = child.cycle < cut;
+        const std::vector<TraceEntry> &trace = before_cut ? trace1 : trace2;
+        size_t &next = before_cut ? next1 : next2;
+        bool due = next < trace.size();
+        if (before_cut)
+            due = due && trace[next].cycle <= child.cycle && trace[next].cycle < cut;
+        else if (params.crossover == Crossover::Cycle)
+            due = due && trace[next].cycle <= child.cycle;
+
+        int proc_id = -2; // nothing to do this step
+        int count = 1;
+        const bool in_block = child.trace.size() >= mutation.block_begin && child.trace.size() < mutation.block_end;
+        if (in_block || random() % 100 < mutation.rate) {
+            proc_id = random_step(set, mutation.weights, random);
+        } else if (due) {
+            // All copies the parent launched together at this cycle
+            size_t end = next + 1;
+            while (end < trace.size() && trace[end].procId == trace[next].procId && trace[end].cycle == trace[next].cycle)
+                ++end;
+            if (set.is_runnable[trace[next].procId]) {
+                proc_id = trace[next].procId;
+                count = static_cast<int>(end - next);
+                next = end;
+            } else if (!before_cut && params.crossover == Crossover::Subsequence && !child.running.empty()) {
+                proc_id = -1; // wait for the needs of the next launch
             } else {
-                ++it; // Only increment if we didn't erase an element
+                next = end; // dropped
             }
-        }
-        if (first_cycle_process != -1 && (runnable.empty() || (runnable.size() == 1 && runnable[0] == -1 && child.running.empty()))) {
-            runnable.push_back(first_cycle_process); // Re-add the first cycle process to the end of the runnable list
-            is_runnable[first_cycle_process] = true; // Mark it as runnable again
+        } else {
+            proc_id = child.running.empty() ? random_step(set, mutation.weights, random) : -1;
         }
 
-        int random_choice = rand() % 100; // Randomly choose between parent1 action, parent2 action and mutation
-
-        // parent1.trace[i].procId in runnable_list
-        if (i < parent1_size // Check if i is within bounds
-            && is_runnable[parent1.value().trace[i].procId]
-            && random_choice < 100 - params.mutationRate / 2) // check if we should use parent1
-        {
-            apply_process(child, cfg, parent1.value().trace[i].procId, missing, runnable, is_runnable);
-        } else if (i < parent2_size
-            && is_runnable[parent2.value().trace[i].procId]
-            && !(random_choice > 100 - params.mutationRate / 2))
-        {
-            apply_process(child, cfg, parent2.value().trace[i].procId, missing, runnable, is_runnable);
-        } else { // mutate means random choice in runnable processes. Mutate if random_choice is greater than 100 - mutationRate or if parent_1 and parent_2 process at i are not runnable
-            int proc_id = runnable[rand() % runnable.size()];
-            apply_process(child, cfg, proc_id, missing, runnable, is_runnable);
+        if (proc_id == -1) {
+            if (wait_and_detect_steady_state(child, cfg, set, steady_state, params.maxCycles))
+                break;
+        } else if (proc_id >= 0) {
+            apply_launches(child, cfg, proc_id, std::min(count, max_launches(child, cfg, proc_id)), set);
         }
 
-        const int missing_size = static_cast<int>(missing.size());
-        for (int j = 0; j < missing_size; ++j) {
-            if (!is_runnable[j] && missing[j] == 0) {
-                is_runnable[j] = true; // Mark as runnable if no more missing items
-                runnable.push_back(j);
-            }
-        }
-        delete_high_stock_processes(runnable, is_runnable, cfg, child);
-        ++i;
+        restore_parked(set);
+        delete_high_stock_processes(set, cfg, child);
     }
+}
+
+
+/**
+ * @brief Function to generate a child candidate from the expanded traces of two parents, see run_crossover.
+ */
+Candidate generate_crossover_child(const Config &cfg, const GeneticParameters &params, const PolicyMutation &mutation, PolicyRandom &random,
+                                   const std::vector<TraceEntry> &trace1, const std::vector<TraceEntry> &trace2) {
+    Candidate child;
+    RunnableSet set;
+    init_simulation(child, cfg, set);
+    delete_high_stock_processes(set, cfg, child);
+    run_crossover(child, set, cfg, params, mutation, random, trace1, trace2);
     return child;
 }
 
@@ -307,10 +275,12 @@ Candidate generate_child(const Config &cfg, const GeneticParameters &params, std
  *
  * @param cfg The configuration containing the processes and initial stocks.
  * @param params The genetic parameters for the algorithm.
+ * @param mutation The random steps of the candidate.
+ * @param random The random source of the policy.
  * @return A new candidate with a fully random trace.
  */
-Candidate generate_candidate(const Config &cfg, const GeneticParameters &params) {
-    return generate_child(cfg, params);
+Candidate generate_candidate(const Config &cfg, const GeneticParameters &params, const PolicyMutation &mutation, PolicyRandom &random) {
+    return generate_child(cfg, params, mutation, random);
 }
 
 
@@ -323,43 +293,11 @@ Candidate generate_candidate(const Config &cfg, const GeneticParameters &params)
  * @return An integer score for the candidate.
  */
 int score_candidate(const Candidate &candidate, const Config &cfg, const GeneticParameters &params) {
-
-    std::string target;
-
-    if (cfg.optimizeKeys.size() == 1 && cfg.optimizeKeys[0] == "time") {
-        if (candidate.cycle == 0) {
-            return 100000; // No running processes, return max score
-        }
-        return 100000 / candidate.cycle;
-    }
-
-    for (const auto& key : cfg.optimizeKeys) {
-        if (key != "time") {
-            target = key;
-            break; // We only need one target for scoring
-        }
-    }
-
-    const int inf = 1000000; // Arbitrary large value for unreachable stocks
-    const double targetQty = candidate.stocks_by_id[cfg.item_to_id.at(target)];
-
-    double interm = 0.0;
-    for (size_t i = 0; i < candidate.stocks_by_id.size(); ++i) {
-        std::string s = cfg.id_to_item[i];
-        const int qty = candidate.stocks_by_id[i];
-        if (s == target || qty <= 0) continue;
-        auto it = cfg.dist.find(s);
-
-        if (it == cfg.dist.end() || it->second >= inf) continue; // unreachable → no credit
-        const double w = std::pow(params.score_decay, it->second);
-        interm += w * qty;
-    }
-    return params.score_alpha * targetQty + params.score_beta * interm;
+    return score_stocks(candidate.stocks_by_id, candidate.cycle, cfg, {params.score_alpha, params.score_beta, params.score_decay});
 }
 
 
-Candidate solve_with_ga(const Config &cfg, long timeBudgetMs){
-    GeneticParameters params;
+Candidate solve_with_ga(const Config &cfg, long timeBudgetMs, const GeneticParameters &params){
     Candidate best_candidate;
     best_candidate.stocks_by_id.assign(cfg.item_to_id.size(), 0);
     for (auto& [name, qty] : cfg.initialStocks)
@@ -368,21 +306,44 @@ Candidate solve_with_ga(const Config &cfg, long timeBudgetMs){
     // get start time
     auto start_time = std::chrono::steady_clock::now();
 
-    srand(start_time.time_since_epoch().count());
+    PolicyRandom random(static_cast<PolicyRandom::result_type>(start_time.time_since_epoch().count()));
 
+    const int target = target_item(cfg);
+
+    // Random steps, weighted by the distance of the processes to the target for the weighted mutation
+    const std::vector<double> weights = mutation_weights(cfg, params.score_decay);
+    PolicyMutation mutation;
+    mutation.rate = params.mutationRate;
+    mutation.weights = params.mutation != Mutation::Weighted ? nullptr : &weights;
+
+    // A candidate whose fingerprint is already in the population is a duplicate, it is not inserted
     std::vector<Candidate> candidates;
-    for (int i = 0; i < params.populationSize; ++i) {
+    std::unordered_set<uint64_t> fingerprints;
+    long duplicates = 0;
+    long evaluations = 0;
+    auto insert_candidate = [&](Candidate candidate) {
+        ++evaluations;
+        if (!fingerprints.insert(trace_fingerprint(candidate, params.fingerprintLaunches).full).second) {
+            ++duplicates;
+            return;
+        }
+        candidates.push_back(std::move(candidate));
+    };
+
+    // The greedy schedule seeds the population, so that the first parents are not only random traces
+    GreedyParameters greedy;
+    greedy.maxCycles = params.maxCycles;
+    insert_candidate(solve_with_greedy(cfg, timeBudgetMs / 10, greedy));
+    for (int i = 1; i < params.populationSize; ++i) {
         auto current_time = std::chrono::steady_clock::now();
         auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - start_time).count();
         if (elapsed_time > timeBudgetMs) {
             break;
         }
-        //std::cout << "Generating candidate " << i + 1 << " of " << params.populationSize << std::endl;
-        candidates.push_back(generate_candidate(cfg, params));
+        insert_candidate(generate_candidate(cfg, params, mutation, random));
     }
 
-    for (int i = 0; i < params.maxIter; ++i) {
-        //std::cout << "Iteration " << i + 1 << " of " << params.maxIter << std::endl;
+    for (int i = 0; i < params.maxIter && !candidates.empty(); ++i) {
         // check if we reached the time budget
         auto current_time = std::chrono::steady_clock::now();
         auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - start_time).count();
@@ -400,35 +361,65 @@ Candidate solve_with_ga(const Config &cfg, long timeBudgetMs){
             return score_a > score_b;
         });
 
+        if (params.stats) {
+            // Diversity: share of the population starting with distinct launches
+            std::unordered_set<uint64_t> prefixes;
+            for (const Candidate &candidate : candidates)
+                prefixes.insert(trace_fingerprint(candidate, params.fingerprintLaunches).prefix);
+            *params.stats << "generation " << i << ": best score " << score_candidate(candidates[0], cfg, params)
+                          << ", population " << candidates.size()
+                          << ", diversity " << 100 * prefixes.size() / candidates.size() << "%"
+                          << ", duplicates rejected " << duplicates << ", evaluations " << evaluations << "\n";
+        }
+
         Candidate parent1 = candidates[0];
-        Candidate parent2 = candidates[1];
+        Candidate parent2 = candidates[candidates.size() > 1 ? 1 : 0];
 
         if (score_candidate(parent1, cfg, params) > score_candidate(best_candidate, cfg, params)) {
             best_candidate = parent1; // Update the best candidate if we found a better one
         }
+        if (target >= 0 && best_candidate.stocks_by_id[target] >= params.goal) {
+            break; // No trace can produce more of the target
+        }
+
+        // The cycle-aligned operators look the launches of the parents up by cycle, in their expanded traces
+        std::vector<TraceEntry> trace1, trace2;
+        if (params.crossover != Crossover::Index) {
+            trace1 = expand_trace(parent1.trace, parent1.period);
+            trace2 = expand_trace(parent2.trace, parent2.period);
+        }
 
         candidates.clear();
+        fingerprints.clear();
+        duplicates = 0;
 
-        // Generate new candidates by crossing over the best ones
+        // Generate new candidates by crossing over the best ones, a converged population stops after as many tries
         size_t pop_size = static_cast<size_t>(params.populationSize);
-        while (candidates.size() < pop_size / 2) {
+        for (size_t tries = 0; candidates.size() < pop_size / 2 && tries < pop_size; ++tries) {
             auto current_time_ = std::chrono::steady_clock::now();
             auto elapsed_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(current_time_ - start_time).count();
             if (elapsed_time_ > timeBudgetMs) {
                 break;
             }
-            candidates.push_back(generate_child(cfg, params, parent1, parent2));
+            // A block mutation re-randomizes a window of launches drawn in the first parent
+            PolicyMutation child_mutation = mutation;
+            if (params.mutation == Mutation::Block) {
+                child_mutation.block_begin = random() % (std::max(trace1.size(), parent1.trace.size()) + 1);
+                child_mutation.block_end = child_mutation.block_begin + static_cast<size_t>(params.blockLength);
+            }
+            insert_candidate(params.crossover == Crossover::Index ? generate_child(cfg, params, child_mutation, random, parent1, parent2)
+                                                                  : generate_crossover_child(cfg, params, child_mutation, random, trace1, trace2));
         }
-        while (candidates.size() < pop_size) {
+        for (size_t tries = 0; candidates.size() < pop_size && tries < 2 * pop_size; ++tries) {
             auto current_time_ = std::chrono::steady_clock::now();
             auto elapsed_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(current_time_ - start_time).count();
             if (elapsed_time_ > timeBudgetMs) {
                 break;
             }
-            candidates.push_back(generate_candidate(cfg, params)); // Fill the rest with random candidates
+            insert_candidate(generate_candidate(cfg, params, mutation, random)); // Fill the rest with random candidates
         }
     }
 
     return best_candidate;
 
-}
\ No newline at end of file
+}
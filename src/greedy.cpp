@@ -0,0 +1,142 @@
+/*!
+ *  @file greedy.cpp
+ *  @brief Implementation of the greedy solver of krpsim
+ */
+
+#include "greedy.hpp"
+#include "genetic_algo.hpp"
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
+
+
+namespace {
+
+constexpr long TIME_CHECK_STEPS = 256;  ///< Steps between two checks of the time budget
+
+/**
+ * @brief Processes in launch order: closest result to the target first, ties in process ID order.
+ *
+ * Processes without results leading to the target are left out, unless only time is optimized.
+ */
+std::vector<int> launch_order(const Config &cfg) {
+    const ProcessTable &table = cfg.table;
+    const size_t process_count = table.delay.size();
+    const bool time_only = target_item(cfg) < 0;
+
+    std::vector<double> rank(process_count, std::numeric_limits<double>::infinity());
+    std::vector<int> order;
+    order.reserve(process_count);
+    for (size_t p = 0; p < process_count; ++p) {
+        for (int k = table.result_offsets[p]; k < table.result_offsets[p + 1]; ++k) {
+            auto it = cfg.dist.find(cfg.id_to_item[table.result_item[k]]);
+            if (it != cfg.dist.end())
+                rank[p] = std::min(rank[p], it->second);
+        }
+        if (time_only || rank[p] < std::numeric_limits<double>::infinity())
+            order.push_back(static_cast<int>(p));
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return rank[a] < rank[b]; });
+    return order;
+}
+
+/**
+ * @brief Stock of each item once the running processes finish, beyond which producing more of it is hoarding.
+ *
+ * The cap of an item is saturation times the largest quantity a process needs of it, the target has no cap.
+ */
+std::vector<long> demand_caps(const Config &cfg, int saturation) {
+    const ProcessTable &table = cfg.table;
+    const size_t item_count = table.needer_offsets.size() - 1;
+    std::vector<long> caps(item_count, 0);
+    for (size_t id = 0; id < item_count; ++id) {
+        const int last = table.needer_offsets[id + 1];
+        if (last > table.needer_offsets[id])
+            caps[id] = static_cast<long>(table.needer_qty[last - 1]) * saturation; // needers sorted by quantity
+    }
+    const int target = target_item(cfg);
+    if (target >= 0)
+        caps[target] = std::numeric_limits<long>::max();
+    return caps;
+}
+
+/**
+ * @brief Number of copies of a process still useful: enough for one of its results to reach its cap.
+ *
+ * Results of quantity 0 are left out.
+ */
+long useful_launches(const ProcessTable &table, int pid, const std::vector<long> &projected, const std::vector<long> &caps) {
+    long useful = 0;
+    for (int k = table.result_offsets[pid]; k < table.result_offsets[pid + 1]; ++k) {
+        const int item = table.result_item[k];
+        if (caps[item] == std::numeric_limits<long>::max())
+            return std::numeric_limits<long>::max();
+        const long qty = table.result_qty[k];
+        if (qty <= 0)
+            continue; // producing none of it, the process is not useful for this result
+        useful = std::max(useful, (caps[item] - projected[item] + qty - 1) / qty);
+    }
+    return useful;
+}
+
+} // namespace
+
+
+Candidate solve_with_greedy(const Config &cfg, long timeBudgetMs, const GreedyParameters &params) {
+    const auto start_time = std::chrono::steady_clock::now();
+    const ProcessTable &table = cfg.table;
+    const std::vector<int> order = launch_order(cfg);
+    const std::vector<long> caps = demand_caps(cfg, params.saturation);
+    std::vector<long> projected(caps.size());
+
+    Candidate candidate;
+    RunnableSet set;
+    init_simulation(candidate, cfg, set);
+    delete_high_stock_processes(set, cfg, candidate);
+
+    SteadyStateDetector steady_state;
+    std::vector<int> counts;
+
+    for (long step = 0; !simulation_over(candidate, set, params.maxCycles); ++step) {
+        if (step % TIME_CHECK_STEPS == 0
+            && std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count() > timeBudgetMs)
+            break;
+
+        prepare_policy_step(set, cfg, candidate);
+        for (size_t id = 0; id < projected.size(); ++id)
+            projected[id] = candidate.stocks_by_id[id];
+        for (const RunningProcess &rp : running_entries(candidate.running)) {
+            for (int k = table.result_offsets[rp.id]; k < table.result_offsets[rp.id + 1]; ++k)
+                projected[table.result_item[k]] += static_cast<long>(table.result_qty[k]) * rp.count;
+        }
+        // Launch counts of all processes in one pass. Launches only take stocks until the next wait, so a count stays
+        // an upper bound during the step, and is only recomputed for a process once another one was launched.
+        max_launches_all(candidate, cfg, counts);
+        bool launched = false;
+        for (int pid : order) {
+            if (!set.is_runnable[pid] || counts[pid] == 0)
+                continue;
+            const long room = static_cast<long>(params.maxLaunches) - static_cast<long>(candidate.trace.size());
+            const long useful = useful_launches(table, pid, projected, caps);
+            const long launchable = launched ? max_launches(candidate, cfg, pid) : counts[pid];
+            const int count = static_cast<int>(std::min({launchable, useful, room}));
+            if (count <= 0)
+                continue;
+            apply_launches(candidate, cfg, pid, count, set);
+            launched = true;
+            for (int k = table.result_offsets[pid]; k < table.result_offsets[pid + 1]; ++k)
+                projected[table.result_item[k]] += static_cast<long>(table.result_qty[k]) * count;
+        }
+        if (candidate.running.empty())
+            break; // nothing could be launched
+
+        if (wait_and_detect_steady_state(candidate, cfg, set, steady_state, params.maxCycles))
+            break;
+        restore_parked(set);
+        delete_high_stock_processes(set, cfg, candidate);
+    }
+    return candidate;
+}
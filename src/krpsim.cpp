@@ -11,6 +11,18 @@
 #include "helper.hpp"
 #include "krpsim.hpp"
 #include "genetic_algo.hpp"
+#include "beam_search.hpp"
+#include "mcts.hpp"
+#include "local_search.hpp"
+#include "bounds.hpp"
+#include "greedy.hpp"
+#include "exact.hpp"
+#include "pareto.hpp"
+#include "trace_io.hpp"
+
+#include <cmath>
+#include <memory>
+#include <unistd.h>
 
 
 /**
@@ -32,6 +44,178 @@ int delay_to_ms(const char *delay_str) {
     return delay * 1000; // Convert seconds to milliseconds
 }
 
+///< @brief Command line options of krpsim.
+struct Options {
+    const char *config_path = nullptr;  ///< Path to the configuration file.
+    const char *delay = nullptr;        ///< Time budget in seconds, as given on the command line.
+    bool        timings = false;        ///< Print the duration of each preparation stage to stderr.
+    bool        ga_stats = false;       ///< Print the statistics of each generation of the genetic algorithm to stderr.
+    unsigned    parse_threads = 1;      ///< Threads used to parse the process section (0: all cores).
+    const char *output_path = nullptr;  ///< Write the report to this file instead of stdout.
+    const char *binary_path = nullptr;  ///< Also write the trace in the binary format to this file.
+    bool        compress = false;       ///< Write the periodic part of the trace once with a repeat directive.
+    std::string solver = "ga";          ///< Solver searching the trace: "ga", "beam", "mcts", "greedy", "exact" or "pareto".
+    int         beam_width = 64;        ///< Number of states kept at each depth by the beam search.
+    unsigned    threads = 0;            ///< Threads used by the solver (0: all cores).
+    int         refine = 10;            ///< Percentage of the time budget spent refining the trace of the solver.
+    Crossover   crossover = Crossover::Index; ///< Crossover operator of the genetic algorithm.
+    Mutation    mutation = Mutation::Uniform; ///< Mutation operator of the genetic algorithm.
+    double      gap = 0.0;              ///< The solver stops once the target is within this percentage of its upper bound.
+    std::string tradeoff;               ///< Weights of the objectives picking the trace of the Pareto front, "key:weight,...".
+};
+
+/**
+ * @brief Parse the weights of the objectives picking a trace of the Pareto front, from a "key:weight,..." list.
+ *
+ * Keys are objective names (see pareto_objective_names), objectives left out weigh 0. An empty list weighs every
+ * objective 1.
+ *
+ * @param spec The list given to --tradeoff.
+ * @param names The objective names of the configuration.
+ * @return The weight of each objective, in the order of names.
+ * @throws std::runtime_error if a key is not an objective or a weight is not a number.
+ */
+static std::vector<double> parse_tradeoff(const std::string &spec, const std::vector<std::string> &names) {
+    if (spec.empty())
+        return std::vector<double>(names.size(), 1.0);
+    std::vector<double> weights(names.size(), 0.0);
+    size_t begin = 0;
+    while (begin <= spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == std::string::npos)
+            end = spec.size();
+        const std::string term = spec.substr(begin, end - begin);
+        const size_t colon = term.find(':');
+        const std::string name = term.substr(0, colon);
+        auto it = std::find(names.begin(), names.end(), name);
+        if (colon == std::string::npos || it == names.end())
+            throw std::runtime_error("Invalid trade-off " + term + ", expected one of the optimize keys or time with a weight");
+        double weight = 0.0;
+        const char *text = term.c_str() + colon + 1;
+        auto [ptr, ec] = std::from_chars(text, text + std::strlen(text), weight);
+        if (ec != std::errc{} || *ptr != '\0')
+            throw std::runtime_error("Invalid trade-off weight: " + term);
+        weights[it - names.begin()] = weight;
+        begin = end + 1;
+    }
+    return weights;
+}
+
+/**
+ * @brief Parse the unsigned value of a "--name=value" option.
+ *
+ * @return true if the value is a valid number, false otherwise (an error is printed).
+ */
+template <typename T>
+static bool parse_option_value(const std::string &arg, const char *name, T &value) {
+    const char *text = arg.c_str() + std::strlen(name);
+    auto [ptr, ec] = std::from_chars(text, text + std::strlen(text), value);
+    if (ec != std::errc{} || *ptr != '\0') {
+        std::cerr << "Invalid value for " << std::string(name, std::strlen(name) - 1) << ": " << text << "\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parse the command line arguments.
+ *
+ * Options start with "--" and can be placed anywhere, the two remaining arguments are the
+ * configuration file and the delay.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param opts The options to fill.
+ * @return true if the arguments are valid, false otherwise.
+ */
+static bool parse_args(int argc, char **argv, Options &opts) {
+    std::vector<const char *> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--timings") {
+            opts.timings = true;
+        } else if (arg == "--ga-stats") {
+            opts.ga_stats = true;
+        } else if (arg == "--compress") {
+            opts.compress = true;
+        } else if (arg.rfind("--parse-threads=", 0) == 0) {
+            if (!parse_option_value(arg, "--parse-threads=", opts.parse_threads))
+                return false;
+        } else if (arg.rfind("--solver=", 0) == 0) {
+            opts.solver = arg.substr(std::strlen("--solver="));
+            if (opts.solver != "ga" && opts.solver != "beam" && opts.solver != "mcts" && opts.solver != "greedy" && opts.solver != "exact"
+                && opts.solver != "pareto") {
+                std::cerr << "Unknown solver " << opts.solver << "\n";
+                return false;
+            }
+        } else if (arg.rfind("--beam-width=", 0) == 0) {
+            if (!parse_option_value(arg, "--beam-width=", opts.beam_width))
+                return false;
+            if (opts.beam_width < 1) {
+                std::cerr << "Invalid value for --beam-width: " << opts.beam_width << "\n";
+                return false;
+            }
+        } else if (arg.rfind("--refine=", 0) == 0) {
+            if (!parse_option_value(arg, "--refine=", opts.refine))
+                return false;
+            if (opts.refine < 0 || opts.refine > 100) {
+                std::cerr << "Invalid value for --refine: " << opts.refine << "\n";
+                return false;
+            }
+        } else if (arg.rfind("--crossover=", 0) == 0) {
+            const std::string name = arg.substr(std::strlen("--crossover="));
+            if (name == "index") {
+                opts.crossover = Crossover::Index;
+            } else if (name == "cycle") {
+                opts.crossover = Crossover::Cycle;
+            } else if (name == "subsequence") {
+                opts.crossover = Crossover::Subsequence;
+            } else {
+                std::cerr << "Unknown crossover " << name << "\n";
+                return false;
+            }
+        } else if (arg.rfind("--mutation=", 0) == 0) {
+            const std::string name = arg.substr(std::strlen("--mutation="));
+            if (name == "uniform") {
+                opts.mutation = Mutation::Uniform;
+            } else if (name == "weighted") {
+                opts.mutation = Mutation::Weighted;
+            } else if (name == "block") {
+                opts.mutation = Mutation::Block;
+            } else {
+                std::cerr << "Unknown mutation " << name << "\n";
+                return false;
+            }
+        } else if (arg.rfind("--gap=", 0) == 0) {
+            if (!parse_option_value(arg, "--gap=", opts.gap))
+                return false;
+            if (opts.gap < 0.0 || opts.gap > 100.0) {
+                std::cerr << "Invalid value for --gap: " << opts.gap << "\n";
+                return false;
+            }
+        } else if (arg.rfind("--tradeoff=", 0) == 0) {
+            opts.tradeoff = arg.substr(std::strlen("--tradeoff="));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            if (!parse_option_value(arg, "--threads=", opts.threads))
+                return false;
+        } else if (arg.rfind("--output=", 0) == 0) {
+            opts.output_path = argv[i] + std::strlen("--output=");
+        } else if (arg.rfind("--binary-output=", 0) == 0) {
+            opts.binary_path = argv[i] + std::strlen("--binary-output=");
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << "\n";
+            return false;
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() != 2)
+        return false;
+    opts.config_path = positional[0];
+    opts.delay = positional[1];
+    return true;
+}
+
 /**
  * @brief Main function for the krpsim executable.
  *
@@ -44,41 +228,181 @@ int delay_to_ms(const char *delay_str) {
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on error.
  */
 int main(int argc, char **argv) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <config-file> <delay_in_sec>\n";
+    std::ios::sync_with_stdio(false);
+
+    Options opts;
+    if (!parse_args(argc, argv, opts)) {
+        std::cerr << "Usage: " << argv[0] << " [--timings] [--ga-stats] [--compress] [--parse-threads=N] [--output=FILE] [--binary-output=FILE]"
+                  << " [--solver=ga|beam|mcts|greedy|exact|pareto] [--beam-width=N] [--threads=N] [--refine=PERCENT] [--gap=PERCENT] [--crossover=index|cycle|subsequence] [--mutation=uniform|weighted|block]"
+                  << " [--tradeoff=KEY:WEIGHT,...] <config-file> <delay_in_sec>\n";
         return EXIT_FAILURE;
     }
 
-    std::ifstream in(argv[1]);
+    std::ifstream in(opts.config_path);
     if (!in) {
-        std::cerr << "Cannot open " << argv[1] << "\n";
+        std::cerr << "Cannot open " << opts.config_path << "\n";
         return EXIT_FAILURE;
     }
 
 
     try {
-        int delay = delay_to_ms(argv[2]);
-        Config cfg = parse_config_for_simulation(in);
+        int delay = delay_to_ms(opts.delay);
+        std::vector<StageTiming> timings;
+        ParseOptions parse_opts;
+        parse_opts.timings = opts.timings ? &timings : nullptr;
+        parse_opts.parse_threads = opts.parse_threads;
+        Config cfg = parse_config_for_simulation(in, parse_opts);
         //print_config(cfg);
 
-        std::cout << "\nInitial stocks:\n";
+        if (opts.timings) {
+            std::cerr << "\nPreparation timings:\n";
+            for (const auto &stage : timings)
+                std::cerr << "  " << stage.name << ": " << stage.ms << " ms\n";
+        }
+
+        // The report goes through a buffered writer, directly to the output file if one is given
+        std::unique_ptr<TraceWriter> out = opts.output_path ? std::make_unique<TraceWriter>(std::string(opts.output_path))
+                                                            : std::make_unique<TraceWriter>(STDOUT_FILENO);
+
+        out->write("\nInitial stocks:\n");
         for (const auto &pair : cfg.initialStocks) {
-            std::cout << pair.first << ": " << pair.second << '\n';
+            out->write(pair.first);
+            out->write(": ");
+            out->write(static_cast<long>(pair.second));
+            out->put('\n');
         }
+        out->flush();
 
-        Candidate best_candidate = solve_with_ga(cfg, delay);
+        // The solver gets the time budget left by the refinement of its trace
+        const long refine_ms = static_cast<long>(delay) * opts.refine / 100;
+        const long solver_ms = delay - refine_ms;
 
-        std::cout << "\nSimulation trace:\n";
-        for (const auto &entry : best_candidate.trace) {
-            std::cout << entry.cycle << ":" << cfg.processes[entry.procId].name << '\n';
+        // No trace can produce more of the target than its upper bound, the solvers stop once they are close enough
+        const int target = target_item(cfg);
+        Candidate initial;
+        RunnableSet initial_set;
+        init_simulation(initial, cfg, initial_set);
+        double bound = target >= 0 ? target_upper_bound(cfg, initial.stocks_by_id, MAX_CYCLES) : HUGE_VAL;
+        const double goal = std::isinf(bound) ? bound : std::ceil(bound * (1.0 - opts.gap / 100.0));
+
+        Candidate best_candidate;
+        bool optimal = false;
+        std::vector<Candidate> front;
+        size_t selected = 0;
+        if (opts.solver == "beam") {
+            BeamParameters beam;
+            beam.width = opts.beam_width;
+            beam.threads = opts.threads;
+            beam.goal = goal;
+            best_candidate = solve_with_beam(cfg, solver_ms, beam);
+        } else if (opts.solver == "mcts") {
+            MctsParameters mcts;
+            mcts.threads = opts.threads;
+            mcts.goal = goal;
+            best_candidate = solve_with_mcts(cfg, solver_ms, mcts);
+        } else if (opts.solver == "exact") {
+            ExactParameters exact;
+            exact.threads = opts.threads;
+            best_candidate = solve_exact(cfg, solver_ms, exact, &optimal);
+            if (optimal && target >= 0)
+                bound = best_candidate.stocks_by_id[target]; // the search proved that no trace does better
+        } else if (opts.solver == "pareto") {
+            ParetoParameters pareto;
+            pareto.threads = opts.threads;
+            pareto.stats = opts.ga_stats ? &std::cerr : nullptr;
+            front = solve_pareto(cfg, solver_ms, pareto);
+            selected = select_tradeoff(cfg, front, parse_tradeoff(opts.tradeoff, pareto_objective_names(cfg)));
+            best_candidate = front.empty() ? initial : front[selected];
+        } else if (opts.solver == "greedy") {
+            best_candidate = solve_with_greedy(cfg, solver_ms);
+        } else {
+            GeneticParameters genetic;
+            genetic.goal = goal;
+            genetic.crossover = opts.crossover;
+            genetic.mutation = opts.mutation;
+            genetic.stats = opts.ga_stats ? &std::cerr : nullptr;
+            best_candidate = solve_with_ga(cfg, solver_ms, genetic);
+        }
+        // Refining the trace for the target would move it along the front, away from the selected trade-off
+        if (refine_ms > 0 && !optimal && front.empty())
+            best_candidate = refine_trace(cfg, best_candidate, refine_ms);
+
+        // Steady-state schedules are mostly a repeated block, write it once with a repeat directive.
+        // The solver already keeps the period it extrapolated once in the trace.
+        std::vector<TraceEntry> trace = best_candidate.trace;
+        TracePeriod period = best_candidate.period;
+        if (!opts.compress) {
+            trace = expand_trace(trace, period);
+            period = TracePeriod{};
+        } else if (!period.active()) {
+            // A block of launches repeating in the trace is only written once if it is a steady state
+            const TracePeriod found = find_trace_period(trace);
+            std::vector<TraceEntry> compressed = trace;
+            compress_trace(compressed, found);
+            if (found.active() && trace_replays(cfg, compressed, found)) {
+                trace = std::move(compressed);
+                period = found;
+            }
+        }
+
+        out->write("\nSimulation trace:\n");
+        for (size_t i = 0; i < trace.size(); ++i) {
+            if (period.active() && i == period.start)
+                out->write_repeat(period);
+            out->write_entry(trace[i].cycle, cfg.processes[trace[i].procId].name);
         }
-        std::cout << "\nTotal cycles:" << best_candidate.cycle << "\n";
+        out->write("\nTotal cycles:");
+        out->write(static_cast<long>(best_candidate.cycle));
+        out->put('\n');
 
-        std::cout << "\nFinal stock:\n";
+        out->write("\nFinal stock:\n");
         for (size_t i = 0; i < best_candidate.stocks_by_id.size(); ++i) {
-            std::string item_name = cfg.id_to_item[i];
-            int qty = best_candidate.stocks_by_id[i];
-            std::cout << item_name << ": " << qty << '\n';
+            out->write(cfg.id_to_item[i]);
+            out->write(": ");
+            out->write(static_cast<long>(best_candidate.stocks_by_id[i]));
+            out->put('\n');
+        }
+        if (target >= 0) {
+            out->write("\nUpper bound on ");
+            out->write(cfg.id_to_item[target]);
+            out->write(": ");
+            if (std::isinf(bound)) {
+                out->write("none\n");
+            } else {
+                out->write(static_cast<long>(bound));
+                const double found = best_candidate.stocks_by_id[target];
+                const double gap = bound > 0.0 ? 100.0 * (bound - found) / bound : 0.0;
+                out->write(" (gap: ");
+                out->write(static_cast<long>(std::lround(gap)));
+                out->write("%)\n");
+            }
+        }
+        if (!front.empty()) {
+            const std::vector<std::string> names = pareto_objective_names(cfg);
+            out->write("\nPareto front:\n");
+            for (size_t i = 0; i < front.size(); ++i) {
+                const std::vector<long> objectives = pareto_objectives(cfg, front[i]);
+                for (size_t k = 0; k < names.size(); ++k) {
+                    out->write(k == 0 ? "  " : ", ");
+                    out->write(names[k]);
+                    out->write(": ");
+                    out->write(names[k] == "time" ? -objectives[k] : objectives[k]);
+                }
+                out->write(i == selected ? " (selected)\n" : "\n");
+            }
+        }
+        out->flush();
+
+        if (opts.binary_path) {
+            BinaryTraceEncoder encoder(static_cast<uint32_t>(cfg.source_process_count));
+            for (size_t i = 0; i < trace.size(); ++i) {
+                if (period.active() && i == period.start)
+                    encoder.add_repeat(period);
+                encoder.add(trace[i].cycle, static_cast<uint32_t>(cfg.processes[trace[i].procId].source_id));
+            }
+            TraceWriter binary_out{std::string(opts.binary_path)};
+            encoder.write(binary_out, cfg.source_hash);
+            binary_out.flush();
         }
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << '\n';
@@ -5,11 +5,34 @@
  *  This file serves as the main entry point for the krpsim_verif executable, which
  *  parses a configuration file and the result file and runs the verification (check if process can be run
  *  when it is launch in the trace).
+ *  The trace is streamed through a large read buffer and replayed with stocks indexed by item ID,
+ *  so memory does not depend on the trace length and no allocation is made per line.
  */
 
 #include "krpsim.hpp"
 #include "parsing.hpp"
 #include "krpsim_verif.hpp"
+#include "trace_io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+TraceReplayer::TraceReplayer(const Config &cfg) : cfg_(cfg), stocks_(cfg.id_to_item.size(), 0) {
+    for (const auto &[name, qty] : cfg.initialStocks)
+        stocks_[cfg.item_to_id.at(name)] = qty;
+}
+
 
 /**
  * @brief Resolves finished processes and updates stocks.
@@ -19,124 +42,919 @@
  * It pops the finished processes from the priority queue.
  *
  * @param cycle The current cycle in the simulation.
- * @param running_processes The priority queue of currently running processes.
- * @param stocks The current stocks of items, updated with results from finished processes.
- * @param cfg The configuration containing the processes and their results.
  */
-void resolve_finished_processes(int cycle, RunPQ &running_processes,
-                                std::unordered_map<std::string, int> &stocks,
-                                const Config &cfg) {
-    while (!running_processes.empty() && running_processes.top().finish <= cycle) {
-        const RunningProcess &rp = running_processes.top();
-        const Process &proc = cfg.processes[rp.id];
-        for (const auto &result : proc.results) {
-            stocks[result.name] += result.qty;
+void TraceReplayer::resolve_finished_processes(long cycle) {
+    while (!running_.empty() && running_.top().finish <= cycle) {
+        for (const auto &[id, qty] : cfg_.processes[running_.top().id].results_by_id)
+            stocks_[id] += qty;
+        running_.pop();
+    }
+}
+
+
+/**
+ * @brief Launch a process at a given cycle, without any repeat handling.
+ */
+bool TraceReplayer::launch_one(long cycle, int pid) {
+    cycle_ = cycle;
+    resolve_finished_processes(cycle);
+
+    const Process &proc = cfg_.processes[pid];
+    running_.emplace(cycle + proc.delay, pid);
+    ++launches_;
+    for (const auto &[id, qty] : proc.needs_by_id) {
+        stocks_[id] -= qty;
+        if (stocks_[id] < 0) {
+            error_ = "Insufficient stock of " + cfg_.id_to_item[id] + " to launch process " + proc.name
+                     + " at cycle " + std::to_string(cycle) + ".";
+            return false;
         }
-        running_processes.pop();
     }
+    return true;
+}
+
+
+bool TraceReplayer::launch(long cycle, int pid) {
+    if (!period_.active())
+        return launch_one(cycle, pid);
+
+    if (period_entries_.empty()) {
+        // Snapshot of the state at the start of the first repetition
+        resolve_finished_processes(cycle);
+        period_cycle_ = cycle;
+        period_stocks_ = stocks_;
+        period_running_ = relative_running(cycle);
+    }
+    if (cycle < period_cycle_ || cycle > period_cycle_ + period_.shift) {
+        error_ = "Launch at cycle " + std::to_string(cycle) + " is outside of the repeated period.";
+        return false;
+    }
+    period_entries_.push_back({cycle, pid});
+    if (!launch_one(cycle, pid))
+        return false;
+    return period_entries_.size() < period_.length || repeat_period();
+}
+
+
+bool TraceReplayer::begin_repeat(const TracePeriod &period) {
+    if (period_.active()) {
+        error_ = "Repeat directive inside a repeated period.";
+        return false;
+    }
+    if (period.length == 0 || period.shift <= 0 || period.times < 1) {
+        error_ = "Invalid repeat directive.";
+        return false;
+    }
+    if (period.times > 1) {
+        period_ = period;
+        period_entries_.clear();
+    }
+    return true;
 }
 
 
 /**
- * @brief Main function for the krpsim_verif executable.
+ * @brief Running processes with their finish cycle relative to a cycle, sorted.
+ */
+std::vector<RunningProcess> TraceReplayer::relative_running(long cycle) const {
+    RunPQ copy = running_;
+    std::vector<RunningProcess> relative;
+    relative.reserve(copy.size());
+    for (; !copy.empty(); copy.pop())
+        relative.emplace_back(copy.top().finish - cycle, copy.top().id);
+    std::sort(relative.begin(), relative.end(), [](const RunningProcess &a, const RunningProcess &b) {
+        return a.finish != b.finish ? a.finish < b.finish : a.id < b.id;
+    });
+    return relative;
+}
+
+
+/**
+ * @brief Check the first repetition is repeatable, then skip to the last repetition and replay it.
+ */
+bool TraceReplayer::repeat_period() {
+    const TracePeriod period = period_;
+    period_ = TracePeriod{};
+    const std::string where = "Repeated period starting at cycle " + std::to_string(period_cycle_);
+
+    // State at the start of the second repetition
+    const long next_cycle = period_cycle_ + period.shift;
+    resolve_finished_processes(next_cycle);
+    const std::vector<RunningProcess> running = relative_running(next_cycle);
+    const bool same_running = running.size() == period_running_.size()
+        && std::equal(running.begin(), running.end(), period_running_.begin(),
+                      [](const RunningProcess &a, const RunningProcess &b) { return a.finish == b.finish && a.id == b.id; });
+    if (!same_running) {
+        error_ = where + " does not restore the running processes.";
+        return false;
+    }
+
+    // Skip the repetitions 2 .. times-1: stocks grow by the same delta at each repetition
+    const long skipped = period.times - 2;
+    for (size_t id = 0; id < stocks_.size(); ++id) {
+        const long delta = stocks_[id] - period_stocks_[id];
+        if (delta < 0) {
+            error_ = where + " consumes " + cfg_.id_to_item[id] + ".";
+            return false;
+        }
+        if (delta > 0 && skipped > (std::numeric_limits<long>::max() - stocks_[id]) / delta) {
+            error_ = where + " overflows the stock of " + cfg_.id_to_item[id] + ".";
+            return false;
+        }
+        stocks_[id] += delta * skipped;
+    }
+    const long last_start = next_cycle + skipped * period.shift;
+    running_ = RunPQ();
+    for (const RunningProcess &rp : running)
+        running_.emplace(last_start + rp.finish, rp.id);
+    cycle_ = last_start;
+    launches_ += static_cast<size_t>(skipped) * period.length;
+
+    // Replay the last repetition explicitly, so the rest of the trace starts from an exact state
+    const long last_shift = (period.times - 1) * period.shift;
+    for (const TraceEntry &entry : period_entries_) {
+        if (!launch_one(entry.cycle + last_shift, entry.procId))
+            return false;
+    }
+    period_entries_.clear();
+    return true;
+}
+
+
+bool TraceReplayer::finish(VerifResult &result) {
+    if (period_.active()) {
+        error_ = "Trace ends inside a repeated period.";
+        return false;
+    }
+    // Finish remaining processes
+    while (!running_.empty()) {
+        if (running_.top().finish > cycle_)
+            cycle_ = running_.top().finish;
+        resolve_finished_processes(cycle_);
+    }
+    result.valid = true;
+    result.cycle = cycle_;
+    result.launches = launches_;
+    result.stocks = stocks_;
+    return true;
+}
+
+
+TraceLineReader::TraceLineReader(std::FILE *file, size_t buffer_size) : file_(file), buffer_(buffer_size) {}
+
+
+/**
+ * @brief Move the unread bytes to the front of the buffer and read more data after them.
  *
- * This function reads the configuration file and the trace file, verifies the trace,
- * and prints the final stocks and cycle count.
+ * The buffer is doubled if a single line does not fit in it.
  *
- * @param argc The number of command line arguments.
- * @param argv The command line arguments.
- * @return EXIT_SUCCESS on success, EXIT_FAILURE on error.
+ * @return false if no more data could be read.
  */
-int main(int argc, char **argv) {
-    try {
-        if (argc != 3) {
-            std::cerr << "Usage: " << argv[0] << " <config_file> <result_to_test>\n";
-            return EXIT_FAILURE;
+bool TraceLineReader::refill() {
+    if (eof_)
+        return false;
+    if (begin_ > 0) {
+        std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    if (end_ == buffer_.size())
+        buffer_.resize(buffer_.size() * 2);
+    const size_t read = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+    if (read == 0)
+        eof_ = true;
+    end_ += read;
+    return read > 0;
+}
+
+
+bool TraceLineReader::next(std::string_view &line) {
+    size_t scanned = begin_;
+    while (true) {
+        const void *nl = std::memchr(buffer_.data() + scanned, '\n', end_ - scanned);
+        if (nl) {
+            const size_t pos = static_cast<const char *>(nl) - buffer_.data();
+            line = std::string_view(buffer_.data() + begin_, pos - begin_);
+            begin_ = pos + 1;
+            return true;
+        }
+        scanned = end_ - begin_; // offset after refill, which moves data to the front
+        if (!refill()) {
+            if (begin_ == end_)
+                return false;
+            line = std::string_view(buffer_.data() + begin_, end_ - begin_); // last line without newline
+            begin_ = end_;
+            return true;
         }
+    }
+}
 
-        std::ifstream in(argv[1]);
-        if (!in) {
-            std::cerr << "Cannot open " << argv[1] << "\n";
-            return EXIT_FAILURE;
+
+/**
+ * @brief Same characters as \s in the regex grammar (newlines are already removed).
+ */
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+
+TraceLineKind parse_trace_line(std::string_view line, long &cycle, std::string_view &name) {
+    if (line.empty() || line[0] == '#')
+        return TraceLineKind::SKIP; // skip empty lines and comments
+    if (line[0] == '@' && line.substr(0, 8) == "@repeat:")
+        return TraceLineKind::REPEAT;
+
+    const char *p = line.data();
+    const char *end = p + line.size();
+    while (p < end && is_space(*p)) ++p;
+
+    const char *digits = p;
+    while (p < end && *p >= '0' && *p <= '9') ++p;
+    if (p == digits)
+        return TraceLineKind::OTHER;
+    auto [ptr, ec] = std::from_chars(digits, p, cycle);
+    if (ec != std::errc{})
+        cycle = -1; // out of range, reported by the caller
+
+    while (p < end && is_space(*p)) ++p;
+    if (p == end || *p != ':')
+        return TraceLineKind::OTHER;
+    ++p;
+    while (p < end && is_space(*p)) ++p;
+
+    const char *name_begin = p;
+    while (p < end && *p != ':' && *p != '#' && !is_space(*p)) ++p;
+    if (p == name_begin)
+        return TraceLineKind::OTHER;
+    name = std::string_view(name_begin, p - name_begin);
+
+    while (p < end && is_space(*p)) ++p;
+    return p == end ? TraceLineKind::LAUNCH : TraceLineKind::OTHER;
+}
+
+
+bool parse_repeat_line(std::string_view line, TracePeriod &period) {
+    const char *p = line.data() + 8; // after "@repeat:"
+    const char *end = line.data() + line.size();
+    auto [p1, ec1] = std::from_chars(p, end, period.length);
+    if (ec1 != std::errc{} || p1 == end || *p1 != ':')
+        return false;
+    auto [p2, ec2] = std::from_chars(p1 + 1, end, period.shift);
+    if (ec2 != std::errc{} || p2 == end || *p2 != ':')
+        return false;
+    auto [p3, ec3] = std::from_chars(p2 + 1, end, period.times);
+    if (ec3 != std::errc{})
+        return false;
+    while (p3 < end && is_space(*p3)) ++p3;
+    return p3 == end;
+}
+
+
+ProcessLookup build_process_lookup(const Config &cfg) {
+    ProcessLookup lookup;
+    lookup.reserve(cfg.processes.size() * 2);
+    for (int i = 0; i < static_cast<int>(cfg.processes.size()); ++i)
+        lookup.emplace(cfg.processes[i].name, i);
+    return lookup;
+}
+
+
+VerifResult verify_trace(const Config &cfg, const ProcessLookup &lookup, std::FILE *file) {
+    VerifResult result;
+    TraceReplayer replayer(cfg);
+    TraceLineReader reader(file);
+
+    bool sim_started = false;
+    std::string_view line;
+    std::string_view proc_name;
+    long cycle = 0;
+    while (reader.next(line)) {
+        ++result.lines;
+        const TraceLineKind kind = parse_trace_line(line, cycle, proc_name);
+        if (kind == TraceLineKind::SKIP)
+            continue;
+        if (kind == TraceLineKind::OTHER) {
+            if (sim_started)
+                break;
+            continue;
         }
-        Config cfg = parse_config(in);
+        sim_started = true;
 
+        if (kind == TraceLineKind::REPEAT) {
+            TracePeriod period;
+            if (!parse_repeat_line(line, period)) {
+                result.error = "Invalid repeat directive at line " + std::to_string(result.lines) + ".";
+                break;
+            }
+            if (!replayer.begin_repeat(period)) {
+                result.error = replayer.error();
+                break;
+            }
+            continue;
+        }
+        if (cycle < 0) {
+            result.error = "Invalid cycle at line " + std::to_string(result.lines) + ".";
+            break;
+        }
+        // Check exists
+        auto it = lookup.find(proc_name);
+        if (it == lookup.end()) {
+            result.error = "Process " + std::string(proc_name) + " not found in configuration.";
+            break;
+        }
+        if (!replayer.launch(cycle, it->second)) {
+            result.error = replayer.error();
+            break;
+        }
+    }
+    if (result.error.empty() && std::ferror(file))
+        result.error = "Cannot read trace.";
+    if (result.error.empty() && !replayer.finish(result))
+        result.error = replayer.error();
+    if (!result.error.empty())
+        result.launches = replayer.launches();
+    return result;
+}
 
-        std::ifstream trace_in(argv[2]);
-        if (!trace_in) {
-            std::cerr << "Cannot open trace " << argv[2] << ".\n";
-            return EXIT_FAILURE;
+
+VerifResult verify_binary_trace(const Config &cfg, std::FILE *file) {
+    VerifResult result;
+    TraceReplayer replayer(cfg);
+    try {
+        BinaryTraceReader reader(file);
+        const BinaryTraceHeader &header = reader.header();
+        if (header.config_hash != cfg.source_hash
+            || header.process_count != static_cast<uint32_t>(cfg.source_process_count)) {
+            result.error = "Binary trace was produced for a different configuration.";
+            return result;
         }
 
-        //map process names to IDs
-        std::unordered_map<std::string, int> proc_name_to_id;
-        for (int i = 0; i < static_cast<int>(cfg.processes.size()); ++i) {
-            proc_name_to_id[cfg.processes[i].name] = i;
+        long cycle = 0;
+        uint32_t pid = 0;
+        while (reader.next(cycle, pid)) {
+            ++result.lines;
+            if (pid == header.process_count) {
+                if (!replayer.begin_repeat(reader.repeat())) {
+                    result.error = replayer.error();
+                    break;
+                }
+                continue;
+            }
+            if (pid >= cfg.processes.size()) {
+                result.error = "Invalid process ID " + std::to_string(pid) + " at entry " + std::to_string(result.lines) + ".";
+                break;
+            }
+            if (cycle < 0) {
+                result.error = "Invalid cycle at entry " + std::to_string(result.lines) + ".";
+                break;
+            }
+            if (!replayer.launch(cycle, static_cast<int>(pid))) {
+                result.error = replayer.error();
+                break;
+            }
+        }
+    } catch (const std::runtime_error &e) {
+        result.error = e.what();
+    }
+    const size_t lines = result.lines;
+    if (result.error.empty() && !replayer.finish(result))
+        result.error = replayer.error();
+    if (!result.error.empty())
+        result.launches = replayer.launches();
+    result.lines = lines;
+    return result;
+}
+
+
+///< @brief A trace line parsed and resolved by a parser thread.
+struct TraceRecord {
+    long        cycle;  ///< Launch cycle, or offset of the line in the block text for RECORD_UNKNOWN and RECORD_REPEAT
+    int         pid;    ///< Process ID, or one of the RECORD_* codes
+    uint32_t    line;   ///< Line index inside the block
+};
+
+enum : int {
+    RECORD_OTHER = -1,      ///< Line that is not a launch (ends the trace once started)
+    RECORD_UNKNOWN = -2,    ///< Launch of a process that is not in the configuration
+    RECORD_BAD_CYCLE = -3,  ///< Launch with a cycle out of range
+    RECORD_REPEAT = -4      ///< Repeat directive
+};
+
+///< @brief Slot of the ring buffer shared by the reader, the parsers and the replaying thread.
+struct TraceBlock {
+    enum class State { FREE, FILLED, PARSING, PARSED };
+
+    std::vector<char>           text;           ///< Complete lines of the trace
+    std::vector<TraceRecord>    records;        ///< Parsed launches and other lines, in order
+    uint32_t                    line_count = 0; ///< Number of lines in the block
+    size_t                      seq = 0;        ///< Position of the block in the trace
+    State                       state = State::FREE;
+};
+
+
+/**
+ * @brief Parse the lines of a block into records, resolving process names.
+ */
+static void parse_block(TraceBlock &block, const ProcessLookup &lookup) {
+    block.records.clear();
+    block.line_count = 0;
+    const char *base = block.text.data();
+    const char *p = base;
+    const char *end = base + block.text.size();
+    long cycle = 0;
+    std::string_view name;
+    while (p < end) {
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        const char *eol = nl ? nl : end;
+        const TraceLineKind kind = parse_trace_line(std::string_view(p, eol - p), cycle, name);
+        if (kind == TraceLineKind::OTHER) {
+            block.records.push_back({0, RECORD_OTHER, block.line_count});
+        } else if (kind == TraceLineKind::REPEAT) {
+            block.records.push_back({static_cast<long>(p - base), RECORD_REPEAT, block.line_count});
+        } else if (kind == TraceLineKind::LAUNCH) {
+            auto it = lookup.find(name);
+            if (cycle < 0)
+                block.records.push_back({0, RECORD_BAD_CYCLE, block.line_count});
+            else if (it == lookup.end())
+                block.records.push_back({static_cast<long>(p - base), RECORD_UNKNOWN, block.line_count});
+            else
+                block.records.push_back({cycle, it->second, block.line_count});
         }
+        ++block.line_count;
+        p = eol + 1;
+    }
+}
 
-        std::unordered_map<std::string, int> stocks = cfg.initialStocks;
 
-        const std::regex re_line(R"(^\s*(\d+)\s*:\s*([^:#\s]+)\s*$)");
+VerifResult verify_trace_pipelined(const Config &cfg, const ProcessLookup &lookup, std::FILE *file,
+                                   unsigned parser_threads) {
+    constexpr size_t block_size = 1 << 20;
+    const size_t slot_count = 2 * static_cast<size_t>(parser_threads) + 2;
+    const size_t no_end = static_cast<size_t>(-1);
 
-        int cycle = 0;
-        bool sim_started = false;
-        RunPQ running_processes;
+    std::vector<TraceBlock> blocks(slot_count);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t next_parse = 0;          // next block to hand to a parser
+    size_t block_total = no_end;    // number of blocks, known once the reader reached the end of file
+    bool stop = false;
+    bool read_error = false;
 
-        std::string line;
-        while (std::getline(trace_in, line)) {
-            if (line.empty() || line[0] == '#') {
-                continue; // skip empty lines and comments
+    // Reader: cut the file in blocks of complete lines
+    std::thread reader([&]() {
+        std::vector<char> carry;
+        for (size_t seq = 0;; ++seq) {
+            TraceBlock &block = blocks[seq % slot_count];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return stop || block.state == TraceBlock::State::FREE; });
+                if (stop) return;
             }
-            std::smatch match;
-            if (std::regex_match(line, match, re_line)) {
-                cycle = std::stoi(match[1]);
-                std::string proc_name = match[2];
-                if (!sim_started) {
-                    sim_started = true;
+            // FREE slots are only touched by the reader
+            block.text.swap(carry);
+            carry.clear();
+            bool eof = false;
+            size_t scan_from = 0;
+            while (true) {
+                const size_t old_size = block.text.size();
+                block.text.resize(old_size + block_size);
+                const size_t read = std::fread(block.text.data() + old_size, 1, block_size, file);
+                block.text.resize(old_size + read);
+                if (read < block_size) {
+                    eof = true;
+                    break;
+                }
+                // Keep the partial last line for the next block
+                const char *base = block.text.data();
+                const char *last_nl = nullptr;
+                for (const char *q = base + block.text.size(); q > base + scan_from; --q) {
+                    if (q[-1] == '\n') { last_nl = q - 1; break; }
+                }
+                if (last_nl) {
+                    carry.assign(last_nl + 1, base + block.text.size());
+                    block.text.resize(last_nl + 1 - base);
+                    break;
                 }
+                scan_from = block.text.size(); // very long line: keep reading
+            }
 
-                resolve_finished_processes(cycle, running_processes, stocks, cfg);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (eof && std::ferror(file))
+                read_error = true;
+            if (block.text.empty()) {
+                block_total = seq;
+            } else {
+                block.seq = seq;
+                block.state = TraceBlock::State::FILLED;
+                if (eof) block_total = seq + 1;
+            }
+            cv.notify_all();
+            if (eof) return;
+        }
+    });
 
-                // Check exists
-                if (proc_name_to_id.find(proc_name) == proc_name_to_id.end()) {
-                    std::cerr << "Process " << proc_name << " not found in configuration.\n";
-                    return EXIT_FAILURE;
+    // Parsers: turn filled blocks into records
+    std::vector<std::thread> parsers;
+    for (unsigned t = 0; t < parser_threads; ++t) {
+        parsers.emplace_back([&]() {
+            while (true) {
+                TraceBlock *block = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&]() {
+                        const TraceBlock &b = blocks[next_parse % slot_count];
+                        return stop || next_parse >= block_total
+                               || (b.state == TraceBlock::State::FILLED && b.seq == next_parse);
+                    });
+                    if (stop || next_parse >= block_total) return;
+                    block = &blocks[next_parse % slot_count];
+                    block->state = TraceBlock::State::PARSING;
+                    ++next_parse;
                 }
+                parse_block(*block, lookup);
+                std::lock_guard<std::mutex> lock(mutex);
+                block->state = TraceBlock::State::PARSED;
+                cv.notify_all();
+            }
+        });
+    }
+
+    // Replay blocks in order on the calling thread
+    VerifResult result;
+    TraceReplayer replayer(cfg);
+    bool sim_started = false;
+    bool done = false;
+    for (size_t seq = 0; !done; ++seq) {
+        TraceBlock &block = blocks[seq % slot_count];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() {
+                return seq >= block_total || (block.state == TraceBlock::State::PARSED && block.seq == seq);
+            });
+            if (seq >= block_total) break;
+        }
 
-                // Launch the process
-                Process proc = cfg.processes[proc_name_to_id[proc_name]];
-                running_processes.emplace(cycle + proc.delay, proc_name_to_id[proc_name]);
-                for (const auto& need : proc.needs) {
-                    stocks[need.name] -= need.qty;
-                    if (stocks[need.name] < 0) {
-                        std::cerr << "Insufficient stock of " << need.name << " to launch process " << proc_name
-                                  << " at cycle " << cycle << ".\n";
-                        return EXIT_FAILURE;
-                    }
+        for (const TraceRecord &record : block.records) {
+            if (record.pid == RECORD_OTHER) {
+                if (!sim_started) continue;
+                result.lines += record.line + 1;
+                done = true;
+                break;
+            }
+            sim_started = true;
+            if (record.pid == RECORD_BAD_CYCLE) {
+                result.error = "Invalid cycle at line " + std::to_string(result.lines + record.line + 1) + ".";
+            } else if (record.pid == RECORD_UNKNOWN || record.pid == RECORD_REPEAT) {
+                const char *text_end = block.text.data() + block.text.size();
+                const char *line = block.text.data() + record.cycle;
+                const char *nl = static_cast<const char *>(std::memchr(line, '\n', text_end - line));
+                const std::string_view line_view(line, (nl ? nl : text_end) - line);
+                if (record.pid == RECORD_UNKNOWN) {
+                    long cycle = 0;
+                    std::string_view proc_name;
+                    parse_trace_line(line_view, cycle, proc_name);
+                    result.error = "Process " + std::string(proc_name) + " not found in configuration.";
+                } else {
+                    TracePeriod period;
+                    if (!parse_repeat_line(line_view, period))
+                        result.error = "Invalid repeat directive at line " + std::to_string(result.lines + record.line + 1) + ".";
+                    else if (!replayer.begin_repeat(period))
+                        result.error = replayer.error();
                 }
-            } else if (sim_started) {
+            } else if (!replayer.launch(record.cycle, record.pid)) {
+                result.error = replayer.error();
+            }
+            if (!result.error.empty()) {
+                result.lines += record.line + 1;
+                done = true;
                 break;
             }
         }
-        // Finish remaining processes
-        while (!running_processes.empty()) {
-            const RunningProcess &rp = running_processes.top();
-            if (rp.finish > cycle) {
-                cycle = rp.finish;
+        if (!done)
+            result.lines += block.line_count;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        block.state = TraceBlock::State::FREE;
+        cv.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        cv.notify_all();
+    }
+    reader.join();
+    for (auto &parser : parsers)
+        parser.join();
+
+    if (result.error.empty() && read_error)
+        result.error = "Cannot read trace.";
+    const size_t lines = result.lines;
+    if (result.error.empty() && !replayer.finish(result))
+        result.error = replayer.error();
+    if (!result.error.empty())
+        result.launches = replayer.launches();
+    result.lines = lines;
+    return result;
+}
+
+
+///< @brief Command line options of krpsim_verif.
+struct Options {
+    const char                  *config_path = nullptr; ///< Path to the configuration file.
+    std::vector<std::string>    trace_paths;            ///< Paths to the traces (or directories of traces in batch mode).
+    bool                        batch = false;          ///< Verify several traces against the same configuration.
+    const char                  *convert = nullptr;     ///< "--to-binary" or "--to-text" to convert a trace instead of verifying it.
+    bool                        stats = false;          ///< Print throughput statistics.
+    bool                        threads_set = false;    ///< Whether --threads was given.
+    unsigned                    threads = 0;            ///< Parser threads (single trace, 0: main thread only) or workers (batch, 0: all cores).
+};
+
+/**
+ * @brief Parse the command line arguments.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param opts The options to fill.
+ * @return true if the arguments are valid, false otherwise.
+ */
+static bool parse_args(int argc, char **argv, Options &opts) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    opts.threads = std::min(4u, cores > 1 ? cores - 1 : 1u);
+
+    std::vector<const char *> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--stats") {
+            opts.stats = true;
+        } else if (arg == "--batch") {
+            opts.batch = true;
+        } else if (arg == "--to-binary" || arg == "--to-text") {
+            opts.convert = argv[i];
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            const char *value = argv[i] + std::strlen("--threads=");
+            auto [ptr, ec] = std::from_chars(value, value + std::strlen(value), opts.threads);
+            if (ec != std::errc{} || *ptr != '\0') {
+                std::cerr << "Invalid value for --threads: " << value << "\n";
+                return false;
             }
-            resolve_finished_processes(cycle, running_processes, stocks, cfg);
+            opts.threads_set = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << "\n";
+            return false;
+        } else {
+            positional.push_back(argv[i]);
         }
+    }
+    if (opts.convert && (opts.batch || positional.size() != 3))
+        return false;
+    if (positional.size() < 2 || (!opts.batch && !opts.convert && positional.size() != 2))
+        return false;
+    opts.config_path = positional[0];
+    opts.trace_paths.assign(positional.begin() + 1, positional.end());
+    return true;
+}
+
+
+/**
+ * @brief Print the statistics of a verification on stderr.
+ */
+static void print_stats(size_t lines, size_t launches, double seconds) {
+    std::cerr << "\nStats:\n  lines: " << lines << "\n  launches: " << launches
+              << "\n  time: " << seconds * 1000.0 << " ms\n  lines/s: "
+              << (seconds > 0.0 ? static_cast<double>(lines) / seconds : 0.0) << "\n";
+}
+
+
+/**
+ * @brief Verify a trace file, in the binary or the text format (detected from the magic bytes).
+ *
+ * @param threads Parser threads for text traces, 0 to verify on the calling thread only.
+ */
+static VerifResult verify_trace_file(const Config &cfg, const ProcessLookup &lookup, const std::string &path,
+                                     unsigned threads) {
+    VerifResult result;
+    std::FILE *trace_in = std::fopen(path.c_str(), "rb");
+    if (!trace_in) {
+        result.error = "Cannot open trace " + path + ".";
+        return result;
+    }
+    if (is_binary_trace(trace_in))
+        result = verify_binary_trace(cfg, trace_in);
+    else if (threads == 0)
+        result = verify_trace(cfg, lookup, trace_in);
+    else
+        result = verify_trace_pipelined(cfg, lookup, trace_in, threads);
+    std::fclose(trace_in);
+    return result;
+}
+
+
+/**
+ * @brief Verify one trace and print the final cycle and stocks.
+ *
+ * @return EXIT_SUCCESS if the trace is valid, EXIT_FAILURE otherwise.
+ */
+static int run_single(const Config &cfg, const ProcessLookup &lookup, const Options &opts) {
+    auto start = std::chrono::steady_clock::now();
+    VerifResult result = verify_trace_file(cfg, lookup, opts.trace_paths[0], opts.threads);
+    auto end = std::chrono::steady_clock::now();
+
+    if (opts.stats)
+        print_stats(result.lines, result.launches, std::chrono::duration<double>(end - start).count());
+
+    if (!result.valid) {
+        std::cerr << result.error << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // print the trace file is valid
+    std::cout << "\nTrace is valid.\n\nFinal cycle: " << result.cycle << "\n";
+    std::cout << "\nFinal stocks:\n";
+    for (size_t id = 0; id < result.stocks.size(); ++id) {
+        std::cout << "  " << cfg.id_to_item[id] << ": " << result.stocks[id] << "\n";
+    }
+    return EXIT_SUCCESS;
+}
 
-        // print the trace file is valid
-        std::cout << "\nTrace is valid.\n\nFinal cycle: " << cycle << "\n";
-        std::cout << "\nFinal stocks:\n";
-        for (const auto& [name, qty] : stocks) {
-            std::cout << "  " << name << ": " << qty << "\n";
+
+/**
+ * @brief Verify many traces against the same configuration, in parallel across cores.
+ *
+ * Directories given as trace paths are expanded to the regular files they contain (sorted by name).
+ * Each trace is verified on a single worker thread, one result line is printed per trace, in input order.
+ *
+ * @return EXIT_SUCCESS if every trace is valid, EXIT_FAILURE otherwise.
+ */
+static int run_batch(const Config &cfg, const ProcessLookup &lookup, const Options &opts) {
+    std::vector<std::string> traces;
+    for (const std::string &path : opts.trace_paths) {
+        if (std::filesystem::is_directory(path)) {
+            std::vector<std::string> files;
+            for (const auto &entry : std::filesystem::directory_iterator(path))
+                if (entry.is_regular_file())
+                    files.push_back(entry.path().string());
+            std::sort(files.begin(), files.end());
+            traces.insert(traces.end(), files.begin(), files.end());
+        } else {
+            traces.push_back(path);
+        }
+    }
+
+    unsigned workers = opts.threads_set ? opts.threads : 0;
+    if (workers == 0)
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min<unsigned>(workers, std::max<size_t>(1, traces.size()));
+
+    std::vector<VerifResult> results(traces.size());
+    std::atomic<size_t> next{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < workers; ++t) {
+        pool.emplace_back([&]() {
+            for (size_t i = next++; i < traces.size(); i = next++)
+                results[i] = verify_trace_file(cfg, lookup, traces[i], 0);
+        });
+    }
+    for (auto &worker : pool)
+        worker.join();
+    auto end = std::chrono::steady_clock::now();
+
+    size_t failed = 0, lines = 0, launches = 0;
+    for (size_t i = 0; i < traces.size(); ++i) {
+        const VerifResult &result = results[i];
+        lines += result.lines;
+        launches += result.launches;
+        if (result.valid) {
+            std::cout << traces[i] << ": PASS final cycle " << result.cycle << "\n";
+        } else {
+            ++failed;
+            std::cout << traces[i] << ": FAIL " << result.error << "\n";
+        }
+    }
+    std::cout << "\n" << traces.size() - failed << "/" << traces.size() << " traces valid.\n";
+
+    if (opts.stats)
+        print_stats(lines, launches, std::chrono::duration<double>(end - start).count());
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/**
+ * @brief Convert a trace between the text and the binary format.
+ *
+ * Text to binary keeps the lines shaped like `<cycle>:<process_name>` (from the first one to the first other line),
+ * binary to text writes one `<cycle>:<process_name>` line per entry. Stocks are not checked.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error.
+ */
+static int run_convert(const Config &cfg, const ProcessLookup &lookup, const Options &opts) {
+    const std::string &in_path = opts.trace_paths[0];
+    const std::string &out_path = opts.trace_paths[1];
+    std::FILE *trace_in = std::fopen(in_path.c_str(), "rb");
+    if (!trace_in) {
+        std::cerr << "Cannot open trace " << in_path << ".\n";
+        return EXIT_FAILURE;
+    }
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> guard(trace_in, std::fclose);
+
+    if (std::strcmp(opts.convert, "--to-text") == 0) {
+        BinaryTraceReader reader(trace_in);
+        if (reader.header().config_hash != cfg.source_hash) {
+            std::cerr << "Binary trace was produced for a different configuration.\n";
+            return EXIT_FAILURE;
+        }
+        TraceWriter out(out_path);
+        long cycle = 0;
+        uint32_t pid = 0;
+        while (reader.next(cycle, pid)) {
+            if (pid == reader.header().process_count) {
+                out.write_repeat(reader.repeat());
+                continue;
+            }
+            if (pid >= cfg.processes.size()) {
+                std::cerr << "Invalid process ID " << pid << ".\n";
+                return EXIT_FAILURE;
+            }
+            out.write_entry(cycle, cfg.processes[pid].name);
         }
+        out.flush();
         return EXIT_SUCCESS;
+    }
+
+    BinaryTraceEncoder encoder(static_cast<uint32_t>(cfg.source_process_count));
+    TraceLineReader reader(trace_in);
+    std::string_view line;
+    std::string_view proc_name;
+    long cycle = 0;
+    size_t lineno = 0;
+    bool sim_started = false;
+    while (reader.next(line)) {
+        ++lineno;
+        const TraceLineKind kind = parse_trace_line(line, cycle, proc_name);
+        if (kind == TraceLineKind::SKIP || (kind == TraceLineKind::OTHER && !sim_started))
+            continue;
+        if (kind == TraceLineKind::OTHER)
+            break;
+        sim_started = true;
+        if (kind == TraceLineKind::REPEAT) {
+            TracePeriod period;
+            if (!parse_repeat_line(line, period)) {
+                std::cerr << "Invalid repeat directive at line " << lineno << ".\n";
+                return EXIT_FAILURE;
+            }
+            encoder.add_repeat(period);
+            continue;
+        }
+        auto it = lookup.find(proc_name);
+        if (cycle < 0 || it == lookup.end()) {
+            std::cerr << "Invalid launch at line " << lineno << ".\n";
+            return EXIT_FAILURE;
+        }
+        encoder.add(cycle, static_cast<uint32_t>(it->second));
+    }
+    TraceWriter out(out_path);
+    encoder.write(out, cfg.source_hash);
+    out.flush();
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * @brief Main function for the krpsim_verif executable.
+ *
+ * This function reads the configuration file and the trace file(s), verifies the trace(s),
+ * and prints the final stocks and cycle count (or one result line per trace in batch mode).
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error.
+ */
+int main(int argc, char **argv) {
+    try {
+        Options opts;
+        if (!parse_args(argc, argv, opts)) {
+            std::cerr << "Usage: " << argv[0] << " [--stats] [--threads=N] <config_file> <result_to_test>\n"
+                      << "       " << argv[0] << " --batch [--stats] [--threads=N] <config_file> <trace|dir>...\n"
+                      << "       " << argv[0] << " --to-binary|--to-text <config_file> <trace_in> <trace_out>\n";
+            return EXIT_FAILURE;
+        }
+
+        std::ifstream in(opts.config_path);
+        if (!in) {
+            std::cerr << "Cannot open " << opts.config_path << "\n";
+            return EXIT_FAILURE;
+        }
+        Config cfg = parse_config(in);
+        build_item_index_and_ids(cfg);
+        const ProcessLookup lookup = build_process_lookup(cfg);
+
+        if (opts.convert)
+            return run_convert(cfg, lookup, opts);
+        return opts.batch ? run_batch(cfg, lookup, opts) : run_single(cfg, lookup, opts);
 
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << "\n";
         return EXIT_FAILURE;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,355 @@
+/*!
+ *  @file local_search.cpp
+ *  @brief Implementation of the local search refining the trace found by a krpsim solver
+ *
+ *  Edits are made in place on the current trace and undone when rejected. The replay states before every stride-th
+ *  launch are kept, so an edit at launch i only replays from the checkpoint before i; the checkpoints after it are
+ *  recomputed on the way and kept if the edit is accepted.
+ *
+ *  Traces reaching a steady state are edited in their compressed form, so an edit in the period applies to every
+ *  repetition. The replay runs the period once, checks that it still leads back to the same running processes without
+ *  consuming stocks, and extrapolates the other repetitions like the steady state detection of the solvers.
+ */
+
+#include "local_search.hpp"
+#include "trace_io.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+///< @brief State of a replay before a launch of the trace.
+struct ReplayState {
+    int                 cycle = 0;  ///< cycle of the last launch or finish
+    std::vector<int>    stocks;     ///< stocks, indexed by item ID
+    RunPQ               running;    ///< running processes
+};
+
+/**
+ * @brief Running processes with their finish relative to cycle, sorted, copies finishing together merged.
+ */
+std::vector<RunningProcess> relative_running(const RunPQ &running, int cycle) {
+    std::vector<RunningProcess> entries = running_entries(running);
+    for (RunningProcess &rp : entries)
+        rp.finish -= cycle;
+    std::sort(entries.begin(), entries.end(), [](const RunningProcess &a, const RunningProcess &b) {
+        return a.finish != b.finish ? a.finish < b.finish : a.id < b.id;
+    });
+    size_t merged = 0;
+    for (size_t j = 0; j < entries.size(); ++j) {
+        if (merged > 0 && entries[merged - 1].finish == entries[j].finish && entries[merged - 1].id == entries[j].id)
+            entries[merged - 1].count += entries[j].count;
+        else
+            entries[merged++] = entries[j];
+    }
+    entries.resize(merged);
+    return entries;
+}
+
+///< @brief Replay of a trace with checkpoints.
+class TraceReplayer {
+public:
+    TraceReplayer(const Config &cfg, size_t stride) : cfg_(cfg), stride_(stride) {}
+
+    /**
+     * @brief Replay a trace from the checkpoint before launch `from`, up to the state once everything finishes.
+     *
+     * Checkpoints are only kept before the period, whose replay depends on the state at its start.
+     *
+     * @param trace The trace, compressed if the period is active.
+     * @param period The period of the trace.
+     * @param from First launch that changed since the last committed replay.
+     * @param end_stocks Set to the final stocks.
+     * @param end_cycle Set to the cycle of the last finish.
+     * @return false if a launch lacks stocks, or if the period does not lead back to the same state.
+     */
+    bool replay(const std::vector<TraceEntry> &trace, const TracePeriod &period, size_t from,
+                std::vector<int> &end_stocks, int &end_cycle) {
+        const bool periodic = period.active();
+        const size_t period_start = periodic ? period.start : trace.size();
+        const size_t period_end = periodic ? period.start + period.length : trace.size();
+        first_ = std::min(std::min(from, period_start) / stride_, checkpoints_.size() - 1);
+        state_ = checkpoints_[first_];
+        pending_.clear();
+
+        if (!launch(trace, first_ * stride_, period_start, true))
+            return false;
+        if (periodic && !repeat(trace, period))
+            return false;
+        if (!launch(trace, period_end, trace.size(), false))
+            return false;
+        collect(INT_MAX);
+        end_stocks = state_.stocks;
+        end_cycle = state_.cycle;
+        return true;
+    }
+
+    /**
+     * @brief Keep the checkpoints of the last replay, after an accepted edit.
+     */
+    void commit() {
+        checkpoints_.resize(first_ + 1);
+        for (ReplayState &state : pending_)
+            checkpoints_.push_back(std::move(state));
+    }
+
+    /**
+     * @brief Start from the initial stocks of the configuration.
+     */
+    void reset(const Candidate &initial) {
+        checkpoints_.assign(1, ReplayState{0, initial.stocks_by_id, RunPQ()});
+    }
+
+private:
+    // Collect the results of the processes finishing at or before cycle, the state ends at the last finish
+    void collect(int cycle) {
+        const ProcessTable &table = cfg_.table;
+        while (!state_.running.empty() && state_.running.top().finish <= cycle) {
+            const RunningProcess rp = state_.running.top();
+            state_.running.pop();
+            for (int k = table.result_offsets[rp.id]; k < table.result_offsets[rp.id + 1]; ++k)
+                state_.stocks[table.result_item[k]] += table.result_qty[k] * rp.count;
+            state_.cycle = std::max(state_.cycle, rp.finish);
+        }
+    }
+
+    // Launch the entries [begin, end), recording the checkpoints met if asked
+    bool launch(const std::vector<TraceEntry> &trace, size_t begin, size_t end, bool checkpoints) {
+        const ProcessTable &table = cfg_.table;
+        for (size_t i = begin; i < end; ) {
+            if (checkpoints && i % stride_ == 0 && i / stride_ > first_)
+                pending_.push_back(state_);
+            if (trace[i].cycle > INT_MAX)
+                return false;
+            // Identical launches share one running entry, up to the next checkpoint
+            const int cycle = static_cast<int>(trace[i].cycle);
+            const int pid = trace[i].procId;
+            const size_t limit = checkpoints ? std::min(end, (i / stride_ + 1) * stride_) : end;
+            size_t next = i + 1;
+            while (next < limit && trace[next].procId == pid && trace[next].cycle == trace[i].cycle)
+                ++next;
+            const int count = static_cast<int>(next - i);
+            i = next;
+
+            collect(cycle);
+            state_.cycle = cycle;
+            for (int k = table.need_offsets[pid]; k < table.need_offsets[pid + 1]; ++k) {
+                int &stock = state_.stocks[table.need_item[k]];
+                if (stock < static_cast<long>(table.need_qty[k]) * count)
+                    return false;
+                stock -= table.need_qty[k] * count;
+            }
+            state_.running.emplace(cycle + table.delay[pid], pid, count);
+        }
+        return true;
+    }
+
+    // Run the period once from the cycle of its first launch, then move the state to its last repetition
+    bool repeat(const std::vector<TraceEntry> &trace, const TracePeriod &period) {
+        if (trace[period.start].cycle > INT_MAX - period.shift * period.times)
+            return false;
+        const int cycle = static_cast<int>(trace[period.start].cycle);
+        const int shift = static_cast<int>(period.shift);
+        collect(cycle);
+        const std::vector<int> stocks = state_.stocks;
+        const std::vector<RunningProcess> running = relative_running(state_.running, cycle);
+
+        if (!launch(trace, period.start, period.start + period.length, false))
+            return false;
+        collect(cycle + shift);
+        const std::vector<RunningProcess> after = relative_running(state_.running, cycle + shift);
+        const bool same_running = running.size() == after.size()
+            && std::equal(running.begin(), running.end(), after.begin(), [](const RunningProcess &a, const RunningProcess &b) {
+                   return a.finish == b.finish && a.id == b.id && a.count == b.count;
+               });
+        if (!same_running)
+            return false;
+
+        const long extra = period.times - 1;
+        for (size_t id = 0; id < stocks.size(); ++id) {
+            const long delta = static_cast<long>(state_.stocks[id]) - stocks[id];
+            if (delta < 0 || state_.stocks[id] + extra * delta > INT_MAX)
+                return false; // the next repetitions would lack stocks, or overflow
+            state_.stocks[id] += static_cast<int>(extra * delta);
+        }
+        const int extra_shift = static_cast<int>(extra * shift);
+        RunPQ shifted;
+        for (const RunningProcess &rp : running_entries(state_.running))
+            shifted.emplace(rp.finish + extra_shift, rp.id, rp.count);
+        state_.running = std::move(shifted);
+        state_.cycle += extra_shift;
+        return true;
+    }
+
+    const Config                &cfg_;
+    size_t                      stride_;
+    std::vector<ReplayState>    checkpoints_;   ///< state before launch k * stride
+    std::vector<ReplayState>    pending_;       ///< checkpoints met by the last replay, after the one it started from
+    size_t                      first_ = 0;     ///< checkpoint the last replay started from
+    ReplayState                 state_;
+};
+
+///< @brief Edit of the trace, kept to undo it.
+struct Move {
+    enum Kind { SWAP, SHIFT, INSERT, REMOVE } kind;
+    size_t      from;   ///< first launch changed
+    size_t      a;      ///< SWAP: first launch, SHIFT: new position, INSERT / REMOVE: position
+    size_t      b;      ///< SWAP: second launch, SHIFT: old position
+    TraceEntry  entry;  ///< SHIFT: launch before the shift, REMOVE: removed launch
+    TracePeriod period; ///< period before the edit
+};
+
+/**
+ * @brief Make a random edit of a non-empty trace.
+ *
+ * A launch stays in its part of the trace (before, in or after the period), and each part stays sorted by cycle.
+ */
+Move random_move(std::vector<TraceEntry> &trace, TracePeriod &period, const Config &cfg, int window,
+                 std::minstd_rand &random) {
+    const size_t size = trace.size();
+    const size_t i = random() % size;
+    const size_t reach = static_cast<size_t>(window);
+    const bool periodic = period.active();
+    const bool in_period = periodic && i >= period.start && i < period.start + period.length;
+    const TracePeriod before = period;
+    switch (random() % 4) {
+    case 0: { // swap the processes of two nearby launches
+        const size_t j = std::min(size - 1, i + 1 + random() % reach);
+        std::swap(trace[i].procId, trace[j].procId);
+        return Move{Move::SWAP, i, i, j, {}, before};
+    }
+    case 1: { // shift a launch to the cycle of an earlier launch, or a few cycles earlier
+        const size_t first = !periodic || i < period.start ? 0
+                           : in_period ? period.start : period.start + period.length;
+        const TraceEntry entry = trace[i];
+        long cycle = random() % 2 && i > first ? trace[i - 1 - random() % std::min(i - first, reach)].cycle
+                                               : entry.cycle - 1 - static_cast<long>(random() % reach);
+        cycle = std::max(cycle, first > 0 ? trace[first].cycle : 0L); // the period and the tail keep their first cycle
+        const size_t to = static_cast<size_t>(std::upper_bound(trace.begin() + static_cast<long>(first),
+            trace.begin() + static_cast<long>(i), cycle, [](long c, const TraceEntry &e) { return c < e.cycle; }) - trace.begin());
+        trace.erase(trace.begin() + static_cast<long>(i));
+        trace.insert(trace.begin() + static_cast<long>(to), TraceEntry{cycle, entry.procId});
+        return Move{Move::SHIFT, to, to, i, entry, before};
+    }
+    case 2: { // launch a random process along with launch i, in the same part
+        const int pid = static_cast<int>(random() % cfg.processes.size());
+        trace.insert(trace.begin() + static_cast<long>(i), TraceEntry{trace[i].cycle, pid});
+        if (in_period)
+            ++period.length;
+        else if (periodic && i < period.start)
+            ++period.start;
+        return Move{Move::INSERT, i, i, 0, {}, before};
+    }
+    default: { // remove a launch
+        const TraceEntry entry = trace[i];
+        trace.erase(trace.begin() + static_cast<long>(i));
+        if (in_period)
+            --period.length;
+        else if (periodic && i < period.start)
+            --period.start;
+        return Move{Move::REMOVE, i, i, 0, entry, before};
+    }
+    }
+}
+
+void undo_move(std::vector<TraceEntry> &trace, TracePeriod &period, const Move &move) {
+    switch (move.kind) {
+    case Move::SWAP:
+        std::swap(trace[move.a].procId, trace[move.b].procId);
+        break;
+    case Move::SHIFT:
+        trace.erase(trace.begin() + static_cast<long>(move.a));
+        trace.insert(trace.begin() + static_cast<long>(move.b), move.entry);
+        break;
+    case Move::INSERT:
+        trace.erase(trace.begin() + static_cast<long>(move.a));
+        break;
+    case Move::REMOVE:
+        trace.insert(trace.begin() + static_cast<long>(move.a), move.entry);
+        break;
+    }
+    period = move.period;
+}
+
+} // namespace
+
+
+Candidate refine_trace(const Config &cfg, const Candidate &candidate, long timeBudgetMs, const RefineParameters &params) {
+    const auto start_time = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&]() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    };
+
+    std::vector<TraceEntry> trace = candidate.trace;
+    TracePeriod period = candidate.period;
+    if (trace.empty() || cfg.processes.empty() || timeBudgetMs <= 0)
+        return candidate;
+
+    Candidate initial;
+    RunnableSet set;
+    init_simulation(initial, cfg, set);
+    const size_t stride = std::max<size_t>(1, trace.size() / static_cast<size_t>(std::max(params.checkpoints, 1)) + 1);
+    TraceReplayer replayer(cfg, stride);
+    replayer.reset(initial);
+
+    std::vector<int> stocks;
+    int cycle = 0;
+    if (!replayer.replay(trace, period, 0, stocks, cycle))
+        return candidate; // not a trace the replay accepts, nothing to refine
+    replayer.commit();
+    int score = score_stocks(stocks, cycle, cfg);
+
+    // The candidate may stop before its running processes finish, the refinement has to beat it as it is
+    Candidate best;
+    int best_score = score_stocks(candidate.stocks_by_id, candidate.cycle, cfg);
+    bool improved = false;
+
+    const double initial_temperature = params.temperature * std::abs(score);
+    std::minstd_rand random(static_cast<std::minstd_rand::result_type>(start_time.time_since_epoch().count()));
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    long elapsed;
+    while ((elapsed = elapsed_ms()) < timeBudgetMs && !trace.empty()) {
+        const Move move = random_move(trace, period, cfg, params.window, random);
+        int new_score = 0;
+        bool accepted = false;
+        if (replayer.replay(trace, period, move.from, stocks, cycle)) {
+            new_score = score_stocks(stocks, cycle, cfg);
+            const double temperature = initial_temperature * (1.0 - static_cast<double>(elapsed) / static_cast<double>(timeBudgetMs));
+            accepted = new_score >= score
+                || (temperature > 0.0 && uniform(random) < std::exp((new_score - score) / temperature));
+        }
+        if (!accepted) {
+            undo_move(trace, period, move);
+            continue;
+        }
+        replayer.commit();
+        score = new_score;
+        if (score > best_score || (score == best_score && cycle < (improved ? best.cycle : candidate.cycle))) {
+            improved = true;
+            best_score = score;
+            best.trace = trace;
+            best.period = period;
+            best.cycle = cycle;
+            best.stocks_by_id = stocks;
+        }
+    }
+    return improved ? best : candidate;
+}
+
+
+bool trace_replays(const Config &cfg, const std::vector<TraceEntry> &trace, const TracePeriod &period) {
+    Candidate initial;
+    RunnableSet set;
+    init_simulation(initial, cfg, set);
+    TraceReplayer replayer(cfg, std::max<size_t>(trace.size(), 1));
+    replayer.reset(initial);
+    std::vector<int> stocks;
+    int cycle = 0;
+    return replayer.replay(trace, period, 0, stocks, cycle);
+}
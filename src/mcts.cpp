@@ -0,0 +1,207 @@
+/*!
+ *  @file mcts.cpp
+ *  @brief Implementation of the Monte Carlo tree search solver of krpsim
+ *
+ *  Nodes do not store simulation states: an iteration replays the actions from the root to the selected leaf, which
+ *  costs far less than the playout that follows. The tree is a single arena of nodes guarded by one mutex, held only
+ *  for the selection, the expansion and the backpropagation.
+ */
+
+#include "mcts.hpp"
+#include "genetic_algo.hpp"
+#include "worker_pool.hpp"
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace {
+
+///< @brief Node of the search tree, the state reached by one policy step from its parent.
+struct Node {
+    int     action;             ///< process launched (one copy), -1 for a wait
+    int     first_child = -1;   ///< index of the first child in the arena, children are contiguous
+    int     child_count = 0;    ///< number of children
+    bool    expanded = false;   ///< whether the children were created, a node expanded without children ends the simulation
+    long    visits = 0;         ///< number of scored playouts through the node
+    int     pending = 0;        ///< playouts through the node not scored yet (virtual losses)
+    double  score_sum = 0.0;    ///< sum of the scores of the playouts through the node
+};
+
+///< @brief Tree shared by the threads, every member is guarded by mutex.
+struct Tree {
+    std::mutex                          mutex;
+    std::vector<Node>                   nodes;
+    double                              min_score = std::numeric_limits<double>::max();     ///< lowest playout score
+    double                              max_score = std::numeric_limits<double>::lowest();  ///< highest playout score
+    std::shared_ptr<const Candidate>    best;           ///< best playout, followed by the playouts, replaced when it improves
+    int                                 best_score = 0; ///< score of the best playout
+    bool                                done = false;   ///< whether a playout reached the goal
+};
+
+/**
+ * @brief Child maximizing the UCT value, playouts still running count as the lowest score seen.
+ */
+int select_child(const Tree &tree, const Node &node, double exploration) {
+    const double range = tree.max_score - tree.min_score;
+    const double parent_visits = static_cast<double>(node.visits + node.pending);
+    int best = -1;
+    double best_value = std::numeric_limits<double>::lowest();
+    for (int c = node.first_child; c < node.first_child + node.child_count; ++c) {
+        const Node &child = tree.nodes[c];
+        const long n = child.visits + child.pending;
+        if (n == 0)
+            return c; // every child is tried once first
+        const double mean = (child.score_sum + child.pending * tree.min_score) / static_cast<double>(n);
+        const double exploit = range > 0.0 ? (mean - tree.min_score) / range : 0.5;
+        const double value = exploit + exploration * std::sqrt(std::log(parent_visits) / static_cast<double>(n));
+        if (value > best_value) {
+            best_value = value;
+            best = c;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief One policy step with a chosen action, from a state prepared by prepare_policy_step.
+ */
+void apply_action(Candidate &candidate, const Config &cfg, RunnableSet &set, int action) {
+    if (action == -1)
+        wait_next_finish(candidate, cfg, set);
+    else
+        apply_launches(candidate, cfg, action, 1, set);
+    restore_parked(set);
+    delete_high_stock_processes(set, cfg, candidate);
+}
+
+/**
+ * @brief Select a leaf, expand it, play out from it and score the playout.
+ */
+void iterate(Tree &tree, const Config &cfg, const MctsParameters &params, int target, PolicyRandom &random,
+             std::vector<int> &path, std::vector<int> &actions) {
+    // Selection, the nodes on the path get a virtual loss. Actions are copied as the arena grows under other threads.
+    path.assign(1, 0);
+    actions.clear();
+    {
+        std::lock_guard<std::mutex> lock(tree.mutex);
+        ++tree.nodes[0].pending;
+        while (tree.nodes[path.back()].child_count > 0) {
+            path.push_back(select_child(tree, tree.nodes[path.back()], params.exploration));
+            ++tree.nodes[path.back()].pending;
+            actions.push_back(tree.nodes[path.back()].action);
+        }
+    }
+
+    // Replay the path from the initial state, actions stay valid as the simulation is deterministic
+    Candidate candidate;
+    RunnableSet set;
+    init_simulation(candidate, cfg, set);
+    delete_high_stock_processes(set, cfg, candidate);
+    for (int action : actions) {
+        prepare_policy_step(set, cfg, candidate);
+        apply_action(candidate, cfg, set, action);
+    }
+
+    // Expansion: one child per action of the policy, waiting only if something is running
+    if (!simulation_over(candidate, set, params.maxCycles)) {
+        prepare_policy_step(set, cfg, candidate);
+        int action = -2;
+        {
+            std::lock_guard<std::mutex> lock(tree.mutex);
+            const int leaf = path.back();
+            if (!tree.nodes[leaf].expanded && tree.nodes.size() < static_cast<size_t>(params.maxNodes)) {
+                const int first = static_cast<int>(tree.nodes.size());
+                for (int pid : set.runnable)
+                    if (pid != -1 || !candidate.running.empty())
+                        tree.nodes.push_back(Node{pid});
+                tree.nodes[leaf].first_child = first;
+                tree.nodes[leaf].child_count = static_cast<int>(tree.nodes.size()) - first;
+                tree.nodes[leaf].expanded = true;
+            }
+            if (tree.nodes[leaf].child_count > 0) {
+                path.push_back(select_child(tree, tree.nodes[leaf], params.exploration));
+                ++tree.nodes[path.back()].pending;
+                action = tree.nodes[path.back()].action;
+            }
+        }
+        if (action != -2)
+            apply_action(candidate, cfg, set, action);
+        else
+            restore_parked(set); // the tree is full, the playout starts from the leaf
+    } else {
+        std::lock_guard<std::mutex> lock(tree.mutex);
+        tree.nodes[path.back()].expanded = true;
+    }
+
+    std::shared_ptr<const Candidate> guide; // stays alive if the best playout is replaced meanwhile
+    {
+        std::lock_guard<std::mutex> lock(tree.mutex);
+        guide = tree.best;
+    }
+    // Playout with the policy of the genetic algorithm, the best playout being the parent. Its launches are taken
+    // from the position reached by the leaf, until one of the random moves tried by the tree pays off.
+    run_policy(candidate, set, cfg, params.maxCycles, PolicyMutation{params.mutationRate}, random, guide.get(), nullptr,
+               static_cast<int>(candidate.trace.size()));
+    const int score = score_stocks(candidate.stocks_by_id, candidate.cycle, cfg);
+
+    // Backpropagation, the virtual losses are replaced by the score
+    std::lock_guard<std::mutex> lock(tree.mutex);
+    for (int index : path) {
+        Node &node = tree.nodes[index];
+        --node.pending;
+        ++node.visits;
+        node.score_sum += score;
+    }
+    tree.min_score = std::min(tree.min_score, static_cast<double>(score));
+    tree.max_score = std::max(tree.max_score, static_cast<double>(score));
+    if (score > tree.best_score || (score == tree.best_score && candidate.cycle < tree.best->cycle)) {
+        tree.best_score = score;
+        tree.best = std::make_shared<const Candidate>(std::move(candidate));
+        tree.done = target >= 0 && tree.best->stocks_by_id[target] >= params.goal;
+    }
+}
+
+} // namespace
+
+
+Candidate solve_with_mcts(const Config &cfg, long timeBudgetMs, const MctsParameters &params) {
+    const auto start_time = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&]() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    };
+
+    Tree tree;
+    tree.nodes.reserve(static_cast<size_t>(std::min(params.maxNodes, 1 << 16)));
+    tree.nodes.push_back(Node{-1});
+    Candidate initial;
+    RunnableSet set;
+    init_simulation(initial, cfg, set);
+    tree.best_score = score_stocks(initial.stocks_by_id, 0, cfg);
+    tree.best = std::make_shared<const Candidate>(std::move(initial));
+
+    const int target = target_item(cfg);
+    WorkerPool pool(params.threads);
+    const auto seed = static_cast<PolicyRandom::result_type>(start_time.time_since_epoch().count());
+    pool.run(pool.size(), [&](size_t index, unsigned) {
+        PolicyRandom random(seed + static_cast<PolicyRandom::result_type>(index));
+        std::vector<int> path;
+        std::vector<int> actions;
+        while (elapsed_ms() < timeBudgetMs) {
+            {
+                // The root expanded without children: nothing can be done from the initial stocks
+                std::lock_guard<std::mutex> lock(tree.mutex);
+                if (tree.done || (tree.nodes[0].expanded && tree.nodes[0].child_count == 0))
+                    break;
+            }
+            iterate(tree, cfg, params, target, random, path, actions);
+        }
+    });
+    return *tree.best;
+}
@@ -0,0 +1,327 @@
+/*!
+ *  @file pareto.cpp
+ *  @brief Implementation of the multi-objective solver of krpsim
+ *
+ *  The population is small (a few hundred schedules with the children), so the fronts are sorted by comparing every
+ *  pair of schedules, as in the original NSGA-II. Simulating the children is the costly part, it runs in parallel.
+ */
+
+#include "pareto.hpp"
+#include "genetic_algo.hpp"
+#include "greedy.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+
+namespace {
+
+///< @brief Schedule of the population.
+struct Individual {
+    Candidate           candidate;      ///< simulation state at the end of the schedule, with its trace
+    int                 horizon;        ///< cycle at which the policy stops launching
+    std::vector<long>   objectives;     ///< see pareto_objectives
+    int                 rank = 0;       ///< index of its non-dominated front, 0 for the Pareto front
+    double              crowding = 0.0; ///< distance to its neighbours in its front, summed over the objectives
+};
+
+///< @brief Child to simulate: its parents in the population, if any, and its horizon.
+struct Breeding {
+    const Candidate     *parent1;
+    const Candidate     *parent2;
+    int                 horizon;
+};
+
+/**
+ * @brief Whether objectives a are at least as good as b on every objective, and better on one.
+ */
+bool dominates(const std::vector<long> &a, const std::vector<long> &b) {
+    bool better = false;
+    for (size_t k = 0; k < a.size(); ++k) {
+        if (a[k] < b[k])
+            return false;
+        better = better || a[k] > b[k];
+    }
+    return better;
+}
+
+/**
+ * @brief Sort a population into non-dominated fronts, and set the rank of each schedule.
+ *
+ * @return The indexes of the schedules of each front, the Pareto front first.
+ */
+std::vector<std::vector<size_t>> sort_fronts(std::vector<Individual> &population) {
+    const size_t n = population.size();
+    std::vector<std::vector<size_t>> dominated(n); // schedules dominated by each schedule
+    std::vector<int> dominators(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = i + 1; j < n; ++j) {
+            if (dominates(population[i].objectives, population[j].objectives)) {
+                dominated[i].push_back(j);
+                ++dominators[j];
+            } else if (dominates(population[j].objectives, population[i].objectives)) {
+                dominated[j].push_back(i);
+                ++dominators[i];
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> fronts;
+    std::vector<size_t> front;
+    for (size_t i = 0; i < n; ++i) {
+        if (dominators[i] == 0)
+            front.push_back(i);
+    }
+    while (!front.empty()) {
+        std::vector<size_t> next;
+        for (size_t i : front) {
+            population[i].rank = static_cast<int>(fronts.size());
+            for (size_t j : dominated[i]) {
+                if (--dominators[j] == 0)
+                    next.push_back(j);
+            }
+        }
+        fronts.push_back(std::move(front));
+        front = std::move(next);
+    }
+    return fronts;
+}
+
+/**
+ * @brief Set the crowding distance of the schedules of a front.
+ *
+ * Along each objective, a schedule gets the gap between its two neighbours relative to the range of the front, the
+ * schedules at both ends get an infinite distance so that the extremes of the front are always kept.
+ */
+void assign_crowding(std::vector<Individual> &population, std::vector<size_t> front) {
+    for (size_t i : front)
+        population[i].crowding = 0.0;
+    if (front.empty())
+        return;
+    const size_t objective_count = population[front[0]].objectives.size();
+    for (size_t k = 0; k < objective_count; ++k) {
+        std::sort(front.begin(), front.end(), [&](size_t a, size_t b) {
+            return population[a].objectives[k] < population[b].objectives[k];
+        });
+        const double low = static_cast<double>(population[front.front()].objectives[k]);
+        const double range = static_cast<double>(population[front.back()].objectives[k]) - low;
+        population[front.front()].crowding = std::numeric_limits<double>::infinity();
+        population[front.back()].crowding = std::numeric_limits<double>::infinity();
+        if (range <= 0.0)
+            continue;
+        for (size_t m = 1; m + 1 < front.size(); ++m) {
+            const double gap = static_cast<double>(population[front[m + 1]].objectives[k] - population[front[m - 1]].objectives[k]);
+            population[front[m]].crowding += gap / range;
+        }
+    }
+}
+
+/**
+ * @brief Random horizon in [0, maxCycles], uniform on a log scale so that short schedules are drawn as often as long ones.
+ */
+int random_horizon(int maxCycles, PolicyRandom &random) {
+    const double scale = std::log(static_cast<double>(std::max(maxCycles, 0)) + 1.0);
+    const double horizon = std::exp(std::uniform_real_distribution<double>(0.0, scale)(random)) - 1.0;
+    return std::clamp(static_cast<int>(std::lround(horizon)), 0, std::max(maxCycles, 0));
+}
+
+/**
+ * @brief Simulate the policy of the genetic algorithm until a horizon, following the parents if any.
+ *
+ * Processes launched before the horizon may still be running, see finish_running.
+ */
+Candidate simulate(const Config &cfg, const Breeding &breeding, const PolicyMutation &mutation, PolicyRandom &random) {
+    Candidate child;
+    RunnableSet set;
+    init_simulation(child, cfg, set);
+    delete_high_stock_processes(set, cfg, child);
+    run_policy(child, set, cfg, breeding.horizon, mutation, random, breeding.parent1, breeding.parent2);
+    return child;
+}
+
+} // namespace
+
+
+std::vector<std::string> pareto_objective_names(const Config &cfg) {
+    std::vector<std::string> names;
+    for (const std::string &key : cfg.optimizeKeys) {
+        if (key != "time")
+            names.push_back(key);
+    }
+    names.push_back("time");
+    return names;
+}
+
+
+std::vector<long> pareto_objectives(const Config &cfg, const Candidate &candidate) {
+    std::vector<long> objectives;
+    for (const std::string &key : cfg.optimizeKeys) {
+        if (key != "time")
+            objectives.push_back(candidate.stocks_by_id[cfg.item_to_id.at(key)]);
+    }
+    objectives.push_back(-static_cast<long>(candidate.cycle));
+    return objectives;
+}
+
+
+size_t select_tradeoff(const Config &cfg, const std::vector<Candidate> &front, const std::vector<double> &weights) {
+    std::vector<std::vector<long>> objectives;
+    for (const Candidate &candidate : front)
+        objectives.push_back(pareto_objectives(cfg, candidate));
+    if (objectives.empty())
+        return 0;
+
+    const size_t objective_count = objectives[0].size();
+    std::vector<long> low(objectives[0]), high(objectives[0]);
+    for (const std::vector<long> &point : objectives) {
+        for (size_t k = 0; k < objective_count; ++k) {
+            low[k] = std::min(low[k], point[k]);
+            high[k] = std::max(high[k], point[k]);
+        }
+    }
+
+    size_t best = 0;
+    double best_score = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < objectives.size(); ++i) {
+        double score = 0.0;
+        for (size_t k = 0; k < objective_count && k < weights.size(); ++k) {
+            if (high[k] > low[k])
+                score += weights[k] * static_cast<double>(objectives[i][k] - low[k]) / static_cast<double>(high[k] - low[k]);
+        }
+        if (score > best_score || (score == best_score && objectives[i] > objectives[best])) {
+            best = i;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+
+std::vector<Candidate> solve_pareto(const Config &cfg, long timeBudgetMs, const ParetoParameters &params) {
+    const auto start_time = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&]() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    };
+
+    WorkerPool pool(params.threads);
+    const auto seed = static_cast<PolicyRandom::result_type>(start_time.time_since_epoch().count());
+    PolicyRandom random(seed);
+    const PolicyMutation mutation{params.mutationRate};
+    const size_t pop_size = static_cast<size_t>(std::max(params.populationSize, 1));
+
+    // A schedule whose fingerprint is already in the population is a duplicate, it is not inserted
+    std::vector<Individual> population;
+    std::unordered_set<uint64_t> fingerprints;
+    long duplicates = 0;
+    long evaluations = 0;
+    // Processes still running at the horizon finish before scoring, so that the objectives are those of a replay
+    auto insert_individual = [&](Candidate candidate, int horizon) {
+        ++evaluations;
+        finish_running(candidate, cfg);
+        if (!fingerprints.insert(trace_fingerprint(candidate, params.fingerprintLaunches).full).second) {
+            ++duplicates;
+            return;
+        }
+        std::vector<long> objectives = pareto_objectives(cfg, candidate);
+        population.push_back(Individual{std::move(candidate), horizon, std::move(objectives)});
+    };
+
+    // Children are simulated in parallel, each with its own random source, the ones left when time runs out are dropped
+    auto breed = [&](const std::vector<Breeding> &breedings) {
+        std::vector<std::optional<Candidate>> children(breedings.size());
+        const auto round_seed = seed + static_cast<PolicyRandom::result_type>(evaluations);
+        pool.run(breedings.size(), [&](size_t index, unsigned) {
+            if (elapsed_ms() > timeBudgetMs)
+                return;
+            PolicyRandom child_random(round_seed + static_cast<PolicyRandom::result_type>(index));
+            children[index] = simulate(cfg, breedings[index], mutation, child_random);
+        });
+        for (size_t i = 0; i < breedings.size(); ++i) {
+            if (children[i])
+                insert_individual(std::move(*children[i]), breedings[i].horizon);
+        }
+    };
+
+    // The greedy schedule seeds the population, the other schedules are random until random horizons
+    GreedyParameters greedy;
+    greedy.maxCycles = params.maxCycles;
+    insert_individual(solve_with_greedy(cfg, timeBudgetMs / 10, greedy), params.maxCycles);
+    std::vector<Breeding> breedings;
+    for (size_t i = 1; i < pop_size; ++i)
+        breedings.push_back(Breeding{nullptr, nullptr, random_horizon(params.maxCycles, random)});
+    breed(breedings);
+
+    std::vector<std::vector<size_t>> fronts = sort_fronts(population);
+    for (const std::vector<size_t> &front : fronts)
+        assign_crowding(population, front);
+
+    for (int generation = 0; generation < params.maxIter && elapsed_ms() <= timeBudgetMs; ++generation) {
+        // Binary tournament: the schedule in the better front, or the more isolated one in the same front
+        auto tournament = [&]() -> const Individual & {
+            const Individual &a = population[random() % population.size()];
+            const Individual &b = population[random() % population.size()];
+            return a.rank < b.rank || (a.rank == b.rank && a.crowding > b.crowding) ? a : b;
+        };
+        breedings.clear();
+        for (size_t i = 0; i < pop_size; ++i) {
+            const Individual &parent1 = tournament();
+            const Individual &parent2 = tournament();
+            int horizon = random() % 2 ? parent1.horizon : parent2.horizon;
+            if (random() % 100 < params.mutationRate)
+                horizon = random_horizon(params.maxCycles, random);
+            breedings.push_back(Breeding{&parent1.candidate, &parent2.candidate, horizon});
+        }
+        duplicates = 0;
+        breed(breedings);
+
+        // The best fronts of parents and children make the next population, the last one by crowding distance
+        fronts = sort_fronts(population);
+        std::vector<Individual> survivors;
+        survivors.reserve(pop_size);
+        for (std::vector<size_t> &front : fronts) {
+            if (survivors.size() >= pop_size)
+                break;
+            assign_crowding(population, front);
+            if (survivors.size() + front.size() > pop_size) {
+                std::sort(front.begin(), front.end(), [&](size_t a, size_t b) {
+                    return population[a].crowding > population[b].crowding;
+                });
+                front.resize(pop_size - survivors.size());
+            }
+            for (size_t i : front)
+                survivors.push_back(std::move(population[i]));
+        }
+        population = std::move(survivors);
+        fingerprints.clear();
+        for (const Individual &individual : population)
+            fingerprints.insert(trace_fingerprint(individual.candidate, params.fingerprintLaunches).full);
+
+        if (params.stats) {
+            const size_t front_size = static_cast<size_t>(std::count_if(population.begin(), population.end(),
+                                                                        [](const Individual &i) { return i.rank == 0; }));
+            *params.stats << "generation " << generation << ": front " << front_size
+                          << ", population " << population.size()
+                          << ", duplicates rejected " << duplicates << ", evaluations " << evaluations << "\n";
+        }
+    }
+
+    // The Pareto front of the last population, one schedule per distinct objectives
+    std::vector<Candidate> front;
+    std::set<std::vector<long>> seen;
+    std::sort(population.begin(), population.end(), [](const Individual &a, const Individual &b) {
+        return a.candidate.cycle < b.candidate.cycle;
+    });
+    sort_fronts(population);
+    for (Individual &individual : population) {
+        if (individual.rank == 0 && seen.insert(individual.objectives).second)
+            front.push_back(std::move(individual.candidate));
+    }
+    return front;
+}
@@ -10,6 +10,11 @@
 #include "helper.hpp"
 #include "parsing.hpp"
 
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+
 /**
  * @brief Parse a single item from a string in the format "name:qty".
  *
@@ -179,73 +184,91 @@ void detect_obvious_cycles(Config& cfg) {
         }
     }
 
-    // Tarjan’s SCC (Strongly Connected Components) to find cycles
+    // Tarjan’s SCC (Strongly Connected Components) to find cycles.
+    // Iterative version: each frame keeps the process and the position of the next edge to explore,
+    // so long production chains cannot overflow the call stack.
     std::vector<int> index(proc_count, -1);
     std::vector<int> low(proc_count, 0);
     std::vector<int> stack;
     std::vector<bool> on_stack(proc_count, false);
+    std::vector<std::pair<int, size_t>> frames; // (pid, next edge index in adj[pid])
     stack.reserve(proc_count);
+    frames.reserve(proc_count);
     int idx = 0;
 
-    std::function<void(int)> dfs = [&](const int pid) {
-        idx++;
-        index[pid] = idx;
-        low[pid] = idx;
-        stack.push_back(pid);
-        on_stack[pid] = true;
-
-        for (int next_pid : adj[pid]) {
-            if (index[next_pid] == -1) {
-                dfs(next_pid);
-                low[pid] = std::min(low[pid], low[next_pid]);
-            } else if (on_stack[next_pid]) {
-                low[pid] = std::min(low[pid], index[next_pid]);
+    for (int root = 0; root < proc_count; ++root) {
+        if (index[root] != -1) continue;
+
+        frames.emplace_back(root, 0);
+        while (!frames.empty()) {
+            auto &[pid, edge] = frames.back();
+            if (edge == 0 && index[pid] == -1) {
+                idx++;
+                index[pid] = idx;
+                low[pid] = idx;
+                stack.push_back(pid);
+                on_stack[pid] = true;
             }
-        }
 
-        // Root of an SCC
-        if (low[pid] == index[pid]) {
-            std::vector<int> cycle;
-            int tmp_pid;
-            do {
-                tmp_pid = stack.back();
-                stack.pop_back();
-                on_stack[tmp_pid] = false;
-                cycle.push_back(tmp_pid);
-            } while (tmp_pid != pid);
-
-            if (cycle.size() > 1) {
-                for (int pid_cycle : cycle)
-                    cfg.processes[pid_cycle].in_cycle = true;
-            } else {
-                // Single node: only mark if strict self-loop exists
-                int pid_cycle = cycle[0];
-                if (self_edge[pid_cycle])
-                    cfg.processes[pid_cycle].in_cycle = true; // auto cycle
+            if (edge < adj[pid].size()) {
+                const int next_pid = adj[pid][edge++];
+                if (index[next_pid] == -1) {
+                    frames.emplace_back(next_pid, 0); // invalidates pid/edge references
+                } else if (on_stack[next_pid]) {
+                    low[pid] = std::min(low[pid], index[next_pid]);
+                }
+                continue;
+            }
+
+            // All edges explored: pop the frame and propagate low-link to the parent
+            const int done_pid = pid;
+            frames.pop_back();
+            if (!frames.empty()) {
+                const int parent = frames.back().first;
+                low[parent] = std::min(low[parent], low[done_pid]);
+            }
+
+            // Root of an SCC
+            if (low[done_pid] == index[done_pid]) {
+                size_t first = stack.size();
+                do {
+                    --first;
+                } while (stack[first] != done_pid);
+
+                if (stack.size() - first > 1) {
+                    for (size_t k = first; k < stack.size(); ++k)
+                        cfg.processes[stack[k]].in_cycle = true;
+                } else if (self_edge[done_pid]) {
+                    // Single node: only mark if strict self-loop exists
+                    cfg.processes[done_pid].in_cycle = true; // auto cycle
+                }
+                for (size_t k = first; k < stack.size(); ++k)
+                    on_stack[stack[k]] = false;
+                stack.resize(first);
             }
         }
-    };
+    }
 
+    // Count, for each item, how many distinct processes produce it
+    const int item_count = static_cast<int>(cfg.id_to_item.size());
+    std::vector<int> producer_count(item_count, 0);
+    std::vector<int> last_producer(item_count, -1); // avoid counting a process twice for the same item
     for (int pid = 0; pid < proc_count; ++pid) {
-        if (index[pid] == -1) dfs(pid);
+        for (const auto &[id, _] : cfg.processes[pid].results_by_id) {
+            if (last_producer[id] != pid) {
+                last_producer[id] = pid;
+                ++producer_count[id];
+            }
+        }
     }
 
     // Put in_cycle to false if it is the only process producing the item
     for (Process &proc : cfg.processes) {
-        if (proc.in_cycle) {
-            for (Item &item : proc.results) {
-                bool only_producer = true;
-                for (Process &other_proc : cfg.processes) {
-                    if (other_proc.name != proc.name &&
-                        std::find(other_proc.results.begin(), other_proc.results.end(), item) != other_proc.results.end()) {
-                        only_producer = false;
-                        break;
-                    }
-                }
-                if (only_producer) {
-                    proc.in_cycle = false;
-                    break; // No need to check other items
-                }
+        if (!proc.in_cycle) continue;
+        for (const auto &[id, _] : proc.results_by_id) {
+            if (producer_count[id] == 1) {
+                proc.in_cycle = false;
+                break; // No need to check other items
             }
         }
     }
@@ -264,7 +287,7 @@ void detect_obvious_cycles(Config& cfg) {
  * @param selected_processes A set to keep track of selected process names.
  * @param target The target item to search for in the results of the processes.
  */
-void select_processes_rec(Config &cfg, std::unordered_set<std::string>& selected_processes, const Item& target) {
+void select_processes_rec(const Config &cfg, std::unordered_set<std::string>& selected_processes, const Item& target) {
     for (const Process &proc : cfg.processes) {
         if (std::find(proc.results.begin(), proc.results.end(), target) != proc.results.end()) {
             if (selected_processes.find(proc.name) == selected_processes.end()) {
@@ -279,14 +302,14 @@ void select_processes_rec(Config &cfg, std::unordered_set<std::string>& selected
 
 
 /**
- * @brief Select processes based on the optimization keys in the configuration.
+ * @brief Collect the names of the processes needed to produce the optimization keys.
  *
- * This function iterates through the optimization keys and selects processes that are needed
- * to produce the items specified in those keys, excluding the "time" key.
+ * Read-only counterpart of processes_selection, so it can run alongside other passes reading the process list.
  *
  * @param cfg The configuration containing the processes and optimization keys.
+ * @return The set of selected process names.
  */
-void processes_selection(Config &cfg) {
+static std::unordered_set<std::string> collect_selected_processes(const Config &cfg) {
     std::unordered_set<std::string> selected_processes;
     for (const auto &goal : cfg.optimizeKeys) {
         if (goal != "time") {
@@ -294,8 +317,19 @@ void processes_selection(Config &cfg) {
             select_processes_rec(cfg, selected_processes, target);
         }
     }
+    return selected_processes;
+}
 
-    // Remove processes not in the selection
+
+/**
+ * @brief Remove the processes that are not part of the selection.
+ *
+ * If the selection is empty, processes are kept untouched.
+ *
+ * @param cfg The configuration containing the processes.
+ * @param selected_processes The set of selected process names.
+ */
+static void keep_selected_processes(Config &cfg, const std::unordered_set<std::string> &selected_processes) {
     std::vector<Process> filtered_processes;
     for (const Process &proc : cfg.processes) {
         if (selected_processes.find(proc.name) != selected_processes.end()) {
@@ -308,6 +342,19 @@ void processes_selection(Config &cfg) {
 }
 
 
+/**
+ * @brief Select processes based on the optimization keys in the configuration.
+ *
+ * This function iterates through the optimization keys and selects processes that are needed
+ * to produce the items specified in those keys, excluding the "time" key.
+ *
+ * @param cfg The configuration containing the processes and optimization keys.
+ */
+void processes_selection(Config &cfg) {
+    keep_selected_processes(cfg, collect_selected_processes(cfg));
+}
+
+
 /**
  * @brief Recursively calculate the maximum stocks needed for each item.
  *
@@ -403,7 +450,7 @@ void build_max_stocks(Config &cfg) {
 
     // If min_stock (limiting item) is 0, means as much is produced as needed, so we can only use the initial stock
     if (min_stock == 0) {
-        int init_limiting_stock = cfg.initialStocks[min_stock_name];
+        int init_limiting_stock = cfg.initialStocks.at(min_stock_name);
         cfg.maxStocks.limiting_initial_stock = init_limiting_stock;
         for (const auto& pair : final_stocks) {
             if (pair.first == min_stock_name) {
@@ -438,9 +485,9 @@ void build_max_stocks(Config &cfg) {
     cfg.maxStocks.abs_cap_by_id.assign(item_count, -1);
     cfg.maxStocks.factor_by_id.assign(item_count, -1.0);
     for (auto& [name, cap] : max_stocks)
-        cfg.maxStocks.abs_cap_by_id[cfg.item_to_id[name]] = cap;
+        cfg.maxStocks.abs_cap_by_id[cfg.item_to_id.at(name)] = cap;
     for (auto& [name, fac] : max_stocks_factors)
-        cfg.maxStocks.factor_by_id[cfg.item_to_id[name]] = fac;
+        cfg.maxStocks.factor_by_id[cfg.item_to_id.at(name)] = fac;
 
 }
 
@@ -506,74 +553,213 @@ void build_item_index_and_ids(Config& cfg) {
 }
 
 
-Config parse_config(std::istream &in) {
-    Config cfg;
-    std::string line;
-    size_t lineno = 0;
+void build_process_table(Config& cfg) {
+    ProcessTable &table = cfg.table;
+    const size_t process_count = cfg.processes.size();
+    table = ProcessTable{};
+    table.need_offsets.reserve(process_count + 1);
+    table.result_offsets.reserve(process_count + 1);
+    table.delay.reserve(process_count);
+
+    table.need_offsets.push_back(0);
+    table.result_offsets.push_back(0);
+    for (const auto& p : cfg.processes) {
+        for (auto [id, qty] : p.needs_by_id) {
+            table.need_item.push_back(id);
+            table.need_qty.push_back(qty);
+        }
+        for (auto [id, qty] : p.results_by_id) {
+            table.result_item.push_back(id);
+            table.result_qty.push_back(qty);
+        }
+        table.need_offsets.push_back(static_cast<int>(table.need_item.size()));
+        table.result_offsets.push_back(static_cast<int>(table.result_item.size()));
+        table.delay.push_back(p.delay);
+    }
 
-    enum class Section { STOCKS, PROCESSES, OPTIMIZE } section = Section::STOCKS;
+    // Needers of each item: count, prefix sum, then fill in process order
+    const size_t item_count = cfg.item_to_id.size();
+    table.needer_offsets.assign(item_count + 1, 0);
+    for (int id : table.need_item)
+        ++table.needer_offsets[id + 1];
+    for (size_t id = 0; id < item_count; ++id)
+        table.needer_offsets[id + 1] += table.needer_offsets[id];
+    table.needer_pid.resize(table.need_item.size());
+    table.needer_qty.resize(table.need_item.size());
+    std::vector<int> next(table.needer_offsets.begin(), table.needer_offsets.end() - 1);
+    for (size_t pid = 0; pid < process_count; ++pid) {
+        for (int k = table.need_offsets[pid]; k < table.need_offsets[pid + 1]; ++k) {
+            const int slot = next[table.need_item[k]]++;
+            table.needer_pid[slot] = static_cast<int>(pid);
+            table.needer_qty[slot] = table.need_qty[k];
+        }
+    }
 
-    bool optimize_line_found = false; // Only one optimize line is allowed
+    // Sort the needers of each item by quantity, so a stock change finds the crossed thresholds by binary search
+    std::vector<std::pair<int,int>> needers;
+    for (size_t id = 0; id < item_count; ++id) {
+        const int begin = table.needer_offsets[id];
+        const int end = table.needer_offsets[id + 1];
+        needers.clear();
+        for (int k = begin; k < end; ++k)
+            needers.emplace_back(table.needer_qty[k], table.needer_pid[k]);
+        std::sort(needers.begin(), needers.end());
+        for (int k = begin; k < end; ++k) {
+            table.needer_qty[k] = needers[k - begin].first;
+            table.needer_pid[k] = needers[k - begin].second;
+        }
+    }
+}
 
-    while (std::getline(in, line)) {
-        ++lineno;
-        std::string trimmed(line);
-        trimmed = std::string(trim(trimmed));
-        if (trimmed.empty() || trimmed.front() == '#') continue;
-
-        std::smatch m;
-        switch (section) {
-            case Section::STOCKS:
-                if (std::regex_match(trimmed, m, detail::re_stock)) {
-                    cfg.initialStocks.emplace(m[1].str(), std::stoll(m[2].str()));
-                    break;
-                }
-                if (std::regex_match(trimmed, m, detail::re_process)) {
-                    section = Section::PROCESSES; // fall‑through to parse as process
-                } else {
-                    throw std::runtime_error("Expected stock or process at line " + std::to_string(lineno));
-                }
-            case Section::PROCESSES:
-                if (std::regex_match(trimmed, m, detail::re_process)) {
-                    Process p;
-                    p.name = trim(m[1].str());
-                    p.needs = parse_item_list(m[2].str());
-                    p.results = parse_item_list(m[3].str());
-                    p.delay = std::stoi(m[4].str());
-                    cfg.processes.emplace_back(std::move(p));
-                    break;
-                }
-                if (std::regex_match(trimmed, m, detail::re_optimize)) {
-                    section = Section::OPTIMIZE;
-                } else {
-                    throw std::runtime_error("Expected process or optimize at line " + std::to_string(lineno));
-                }
-            case Section::OPTIMIZE:
-                if (std::regex_match(trimmed, m, detail::re_optimize) && !optimize_line_found) {
-                    optimize_line_found = true;
-                    std::string inside = m[1];
-                    size_t start = 0;
-                    while (start < inside.size()) {
-                        size_t end = inside.find(';', start);
-                        std::string tok{trim(inside.substr(start, end - start))};
-                        if (!tok.empty()) cfg.optimizeKeys.push_back(tok);
-                        if (end == std::string::npos) break;
-                        start = end + 1;
-                    }
-                } else if (optimize_line_found) {
-                    throw std::runtime_error("Multiple optimize lines found at line " + std::to_string(lineno));
-                } else {
-                    throw std::runtime_error("Unexpected content after optimize at line " + std::to_string(lineno));
-                }
+
+///< @brief Section of the configuration file the parser is currently in.
+enum class Section { STOCKS, PROCESSES, OPTIMIZE };
+
+///< @brief State of the line-by-line configuration parser.
+struct ParserState {
+    Section section = Section::STOCKS;  ///< Current section, sections have to be in order
+    bool    optimize_line_found = false; ///< Only one optimize line is allowed
+};
+
+
+/**
+ * @brief Parse a trimmed line as a process definition.
+ *
+ * @param trimmed The trimmed line.
+ * @param proc The process to fill if the line is a process definition.
+ * @return true if the line is a process definition, false otherwise.
+ * @throws std::runtime_error if the line is a process definition with malformed items.
+ */
+static bool parse_process_line(const std::string &trimmed, Process &proc) {
+    std::smatch m;
+    if (!std::regex_match(trimmed, m, detail::re_process))
+        return false;
+    proc.name = trim(m[1].str());
+    proc.needs = parse_item_list(m[2].str());
+    proc.results = parse_item_list(m[3].str());
+    proc.delay = std::stoi(m[4].str());
+    return true;
+}
+
+
+/**
+ * @brief Parse one line of the configuration, updating the parser state.
+ *
+ * @param cfg The configuration being filled.
+ * @param state The parser state (current section).
+ * @param line The raw line.
+ * @param lineno The line number (1-based), used in error messages.
+ * @throws std::runtime_error if the line is not valid in the current section.
+ */
+static void parse_config_line(Config &cfg, ParserState &state, const std::string &line, size_t lineno) {
+    std::string trimmed = trim(line);
+    if (trimmed.empty() || trimmed.front() == '#') return;
+
+    std::smatch m;
+    switch (state.section) {
+        case Section::STOCKS:
+            if (std::regex_match(trimmed, m, detail::re_stock)) {
+                cfg.initialStocks.emplace(m[1].str(), std::stoll(m[2].str()));
                 break;
+            }
+            if (std::regex_match(trimmed, m, detail::re_process)) {
+                state.section = Section::PROCESSES; // fall‑through to parse as process
+            } else {
+                throw std::runtime_error("Expected stock or process at line " + std::to_string(lineno));
+            }
+            [[fallthrough]];
+        case Section::PROCESSES: {
+            Process p;
+            if (parse_process_line(trimmed, p)) {
+                cfg.processes.emplace_back(std::move(p));
+                break;
+            }
+            if (std::regex_match(trimmed, m, detail::re_optimize)) {
+                state.section = Section::OPTIMIZE;
+            } else {
+                throw std::runtime_error("Expected process or optimize at line " + std::to_string(lineno));
+            }
         }
+            [[fallthrough]];
+        case Section::OPTIMIZE:
+            if (std::regex_match(trimmed, m, detail::re_optimize) && !state.optimize_line_found) {
+                state.optimize_line_found = true;
+                std::string inside = m[1];
+                size_t start = 0;
+                while (start < inside.size()) {
+                    size_t end = inside.find(';', start);
+                    std::string tok{trim(inside.substr(start, end - start))};
+                    if (!tok.empty()) cfg.optimizeKeys.push_back(tok);
+                    if (end == std::string::npos) break;
+                    start = end + 1;
+                }
+            } else if (state.optimize_line_found) {
+                throw std::runtime_error("Multiple optimize lines found at line " + std::to_string(lineno));
+            } else {
+                throw std::runtime_error("Unexpected content after optimize at line " + std::to_string(lineno));
+            }
+            break;
     }
+}
+
 
+/**
+ * @brief Compute a FNV-1a hash of the parsed configuration.
+ *
+ * Stocks are hashed sorted by name so the hash does not depend on the hash map order.
+ *
+ * @param cfg The parsed configuration.
+ * @return The 64-bit hash.
+ */
+static uint64_t hash_config(const Config &cfg) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const std::string &text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        hash ^= 0xff; // separator
+        hash *= 1099511628211ull;
+    };
+
+    std::vector<std::pair<std::string, int>> stocks(cfg.initialStocks.begin(), cfg.initialStocks.end());
+    std::sort(stocks.begin(), stocks.end());
+    for (const auto &[name, qty] : stocks) {
+        mix(name);
+        mix(std::to_string(qty));
+    }
+    for (const Process &proc : cfg.processes) {
+        mix(proc.name);
+        for (const Item &need : proc.needs) {
+            mix(need.name);
+            mix(std::to_string(need.qty));
+        }
+        mix("|");
+        for (const Item &result : proc.results) {
+            mix(result.name);
+            mix(std::to_string(result.qty));
+        }
+        mix(std::to_string(proc.delay));
+    }
+    for (const std::string &key : cfg.optimizeKeys)
+        mix(key);
+    return hash;
+}
+
+
+/**
+ * @brief Final checks once every line has been parsed, then record the source IDs and hash.
+ *
+ * @param cfg The parsed configuration.
+ * @throws std::runtime_error if the optimize section is missing or if process names are not unique.
+ */
+static void finish_parsed_config(Config &cfg) {
     if (cfg.optimizeKeys.empty())
         throw std::runtime_error("Missing optimize section");
 
     // check if several processes have the same name
     std::unordered_set<std::string> process_names;
+    process_names.reserve(cfg.processes.size());
     for (const Process &proc : cfg.processes) {
         if (process_names.find(proc.name) != process_names.end()) {
             throw std::runtime_error("Duplicate process name: '" + proc.name + "'");
@@ -581,44 +767,265 @@ Config parse_config(std::istream &in) {
         process_names.insert(proc.name);
     }
 
+    for (size_t pid = 0; pid < cfg.processes.size(); ++pid)
+        cfg.processes[pid].source_id = static_cast<int>(pid);
+    cfg.source_process_count = static_cast<int>(cfg.processes.size());
+    cfg.source_hash = hash_config(cfg);
+}
+
+
+Config parse_config(std::istream &in) {
+    Config cfg;
+    ParserState state;
+    std::string line;
+    size_t lineno = 0;
+
+    while (std::getline(in, line)) {
+        ++lineno;
+        parse_config_line(cfg, state, line, lineno);
+    }
+
+    finish_parsed_config(cfg);
     return cfg;
 }
 
 
-Config parse_config_for_simulation(std::istream &in) {
-    Config cfg = parse_config(in);
+///< @brief Result of parsing one chunk of the process section on a worker thread.
+struct ProcessChunk {
+    std::vector<Process>    processes;          ///< Processes parsed in the chunk, in file order
+    size_t                  line_count = 0;     ///< Number of lines in the chunk (only complete if the chunk did not stop)
+    size_t                  stop_offset = std::string::npos; ///< Offset of the first line that is not a process, if any
+    std::exception_ptr      error;              ///< Error thrown while parsing a process line, if any
+};
 
-    // Initialize the distance map for optimization keys
-    for (const std::string& goal : cfg.optimizeKeys) {
-        if (goal != "time") {
-            cfg.dist[goal] = 0.0;
-            build_dist_map(goal, 0.0, cfg);
+
+/**
+ * @brief Get the end of the line starting at pos (position of the '\n' or end of buffer).
+ */
+static size_t line_end(const std::string &buf, size_t pos, size_t end) {
+    const void *nl = std::memchr(buf.data() + pos, '\n', end - pos);
+    return nl ? static_cast<size_t>(static_cast<const char *>(nl) - buf.data()) : end;
+}
+
+
+/**
+ * @brief Parse process lines of buf in [begin, end) until a line is not a process definition.
+ *
+ * @param buf The whole configuration text.
+ * @param begin Offset of the first line of the chunk.
+ * @param end Offset just after the last line of the chunk.
+ * @return The parsed chunk.
+ */
+static ProcessChunk parse_process_chunk(const std::string &buf, size_t begin, size_t end) {
+    ProcessChunk chunk;
+    size_t pos = begin;
+    while (pos < end) {
+        const size_t eol = line_end(buf, pos, end);
+        std::string trimmed = trim(buf.substr(pos, eol - pos));
+        if (!trimmed.empty() && trimmed.front() != '#') {
+            Process p;
+            try {
+                if (!parse_process_line(trimmed, p)) {
+                    chunk.stop_offset = pos;
+                    return chunk;
+                }
+            } catch (...) {
+                chunk.error = std::current_exception();
+                return chunk;
+            }
+            chunk.processes.emplace_back(std::move(p));
+        }
+        ++chunk.line_count;
+        pos = eol + 1;
+    }
+    return chunk;
+}
+
+
+Config parse_config_chunked(std::istream &in, unsigned thread_count) {
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    const std::string buf{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    const size_t size = buf.size();
+
+    Config cfg;
+    ParserState state;
+    size_t lineno = 0;
+    size_t pos = 0;
+
+    // Stock section is parsed sequentially until the first line that is not a stock
+    while (pos < size) {
+        const size_t eol = line_end(buf, pos, size);
+        const std::string line = buf.substr(pos, eol - pos);
+        const std::string trimmed = trim(line);
+        if (!trimmed.empty() && trimmed.front() != '#' && !std::regex_match(trimmed, detail::re_stock))
+            break;
+        ++lineno;
+        parse_config_line(cfg, state, line, lineno);
+        pos = eol + 1;
+    }
+    const size_t proc_begin = std::min(pos, size);
+
+    // Split the rest in chunks on newline boundaries
+    std::vector<size_t> bounds{proc_begin};
+    const size_t approx = (size - proc_begin) / thread_count + 1;
+    for (unsigned t = 1; t < thread_count; ++t) {
+        size_t cut = std::max(bounds.back(), proc_begin + t * approx);
+        if (cut >= size) break;
+        cut = line_end(buf, cut, size);
+        if (cut >= size) break;
+        bounds.push_back(cut + 1);
+    }
+    bounds.push_back(size);
+
+    std::vector<std::future<ProcessChunk>> futures;
+    for (size_t c = 0; c + 1 < bounds.size(); ++c)
+        futures.push_back(std::async(std::launch::async, parse_process_chunk, std::cref(buf), bounds[c], bounds[c + 1]));
+    std::vector<ProcessChunk> chunks;
+    for (auto &future : futures)
+        chunks.push_back(future.get());
+
+    // Merge in file order. The first chunk that stopped gives the start of the optimize section
+    size_t tail = size;
+    for (ProcessChunk &chunk : chunks) {
+        for (Process &p : chunk.processes)
+            cfg.processes.emplace_back(std::move(p));
+        if (chunk.error)
+            std::rethrow_exception(chunk.error);
+        lineno += chunk.line_count;
+        if (chunk.stop_offset != std::string::npos) {
+            tail = chunk.stop_offset;
             break;
         }
     }
+    if (!cfg.processes.empty())
+        state.section = Section::PROCESSES;
 
-    // Remove processes that are not needed for production of the optimization keys
-    if (cfg.optimizeKeys.size() != 1 || cfg.optimizeKeys[0] != "time") {
-        processes_selection(cfg);
+    // Optimize section (and any error after the processes) is parsed sequentially
+    while (tail < size) {
+        const size_t eol = line_end(buf, tail, size);
+        ++lineno;
+        parse_config_line(cfg, state, buf.substr(tail, eol - tail), lineno);
+        tail = eol + 1;
     }
 
-    build_item_index_and_ids(cfg);
+    finish_parsed_config(cfg);
+    return cfg;
+}
+
+
+/**
+ * @brief Node of the preparation task graph run by parse_config_for_simulation.
+ */
+struct PrepTask {
+    const char*             name;   ///< Stage name, used for timing output
+    std::vector<size_t>     deps;   ///< Indices of the tasks that must be finished before this one starts
+    std::function<void()>   run;    ///< Work of the stage
+};
+
 
-    // Build the max_stock map representing the maximum stock for each item
-    if (cfg.optimizeKeys.size() != 1 || cfg.optimizeKeys[0] != "time") {
-        build_max_stocks(cfg);
+/**
+ * @brief Run a small task graph, launching each task as soon as all its dependencies are done.
+ *
+ * Tasks must be given in topological order (dependencies have a lower index). In parallel mode each task
+ * runs on its own thread and waits on the futures of its dependencies, so independent passes overlap.
+ * Exceptions thrown by a stage are rethrown to the caller.
+ *
+ * @param tasks The tasks to run.
+ * @param parallel Whether independent tasks may run concurrently.
+ * @param timings If not null, receives the duration of each stage (in task order).
+ */
+static void run_task_graph(const std::vector<PrepTask> &tasks, bool parallel, std::vector<StageTiming> *timings) {
+    std::vector<double> durations(tasks.size(), 0.0);
+
+    auto timed_run = [&](size_t t) {
+        auto start = std::chrono::steady_clock::now();
+        tasks[t].run();
+        auto end = std::chrono::steady_clock::now();
+        durations[t] = std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    if (!parallel) {
+        for (size_t t = 0; t < tasks.size(); ++t)
+            timed_run(t);
+    } else {
+        std::vector<std::shared_future<void>> done;
+        done.reserve(tasks.size());
+        for (size_t t = 0; t < tasks.size(); ++t) {
+            std::vector<std::shared_future<void>> deps;
+            for (size_t d : tasks[t].deps)
+                deps.push_back(done[d]);
+            done.push_back(std::async(std::launch::async, [&timed_run, t, deps]() {
+                for (const auto &dep : deps)
+                    dep.get(); // rethrows if a dependency failed
+                timed_run(t);
+            }).share());
+        }
+        for (auto &future : done)
+            future.wait();
+        for (auto &future : done)
+            future.get();
     }
 
-    // Detect obvious cycles in the processes
-    detect_obvious_cycles(cfg);
+    if (timings) {
+        for (size_t t = 0; t < tasks.size(); ++t)
+            timings->push_back({tasks[t].name, durations[t]});
+    }
+}
+
 
-    // Prepare the needers_by_item vector
-    int item_count = static_cast<int>(cfg.item_to_id.size());
-    cfg.needers_by_item.assign(item_count, {});
-    for (size_t pid = 0; pid < cfg.processes.size(); ++pid) {
-        for (auto [id, q] : cfg.processes[pid].needs_by_id)
-            cfg.needers_by_item[id].emplace_back(pid, q);
+Config parse_config_for_simulation(std::istream &in, const ParseOptions &opts) {
+    auto parse_start = std::chrono::steady_clock::now();
+    Config cfg = (opts.parse_threads == 1) ? parse_config(in) : parse_config_chunked(in, opts.parse_threads);
+    if (opts.timings) {
+        auto parse_end = std::chrono::steady_clock::now();
+        opts.timings->push_back({"parse", std::chrono::duration<double, std::milli>(parse_end - parse_start).count()});
     }
 
+    const bool time_only = cfg.optimizeKeys.size() == 1 && cfg.optimizeKeys[0] == "time";
+    std::unordered_set<std::string> selected_processes;
+
+    // Preparation passes. dist and select only read the parsed process list, the passes after index
+    // only read the indexed processes (cycles writes in_cycle, which nobody else reads).
+    enum : size_t { DIST, SELECT, INDEX, MAX_STOCKS, CYCLES, PROCESS_TABLE };
+    std::vector<PrepTask> tasks = {
+        {"dist", {}, [&]() {
+            // Initialize the distance map for optimization keys
+            for (const std::string& goal : cfg.optimizeKeys) {
+                if (goal != "time") {
+                    cfg.dist[goal] = 0.0;
+                    build_dist_map(goal, 0.0, cfg);
+                    break;
+                }
+            }
+        }},
+        {"select", {}, [&]() {
+            // Find processes that are needed for production of the optimization keys
+            if (!time_only)
+                selected_processes = collect_selected_processes(cfg);
+        }},
+        {"index", {DIST, SELECT}, [&]() {
+            // Remove processes that are not needed, then give IDs to items
+            if (!time_only)
+                keep_selected_processes(cfg, selected_processes);
+            build_item_index_and_ids(cfg);
+        }},
+        {"max_stocks", {INDEX}, [&]() {
+            // Build the max_stock map representing the maximum stock for each item
+            if (!time_only)
+                build_max_stocks(cfg);
+        }},
+        {"cycles", {INDEX}, [&]() {
+            // Detect obvious cycles in the processes
+            detect_obvious_cycles(cfg);
+        }},
+        {"process_table", {INDEX}, [&]() {
+            // Flatten the processes and the needers of each item for the simulation
+            build_process_table(cfg);
+        }},
+    };
+    run_task_graph(tasks, opts.parallel_prep, opts.timings);
+
     return cfg;
 }
@@ -0,0 +1,497 @@
+/*!
+ *  @file simulation.cpp
+ *  @brief Implementation of the simulation steps shared by the krpsim solvers
+ *
+ *  The runnable set is updated incrementally: each stock change only visits the processes whose need of the item
+ *  was crossed (found by binary search in the needers sorted by quantity), and processes taken out of the runnable
+ *  list while still launchable are parked instead of rescanning every process after each step. The steps only read
+ *  the flattened process table (Config::table).
+ */
+
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <string>
+
+
+namespace {
+
+constexpr uint64_t RUNNING_BASE = 0x9e3779b97f4a7c15ull;  ///< B of the running hash, odd so that it is invertible modulo 2^64
+
+constexpr uint64_t inverse(uint64_t odd) {
+    uint64_t x = odd; // Newton iteration, each step doubles the number of correct low bits
+    for (int i = 0; i < 6; ++i)
+        x *= 2 - odd * x;
+    return x;
+}
+
+constexpr uint64_t RUNNING_BASE_INVERSE = inverse(RUNNING_BASE);
+static_assert(RUNNING_BASE * RUNNING_BASE_INVERSE == 1, "the base of the running hash must be invertible");
+
+uint64_t power(uint64_t base, uint64_t exponent) {
+    uint64_t result = 1;
+    for (; exponent; exponent >>= 1, base *= base)
+        if (exponent & 1)
+            result *= base;
+    return result;
+}
+
+uint64_t stock_key(int id, int qty) {
+    return mix(static_cast<uint64_t>(id) << 32 | static_cast<uint32_t>(qty));
+}
+
+uint64_t running_key(int pid, int count, int relative_finish) {
+    return mix(~static_cast<uint64_t>(pid)) * static_cast<uint64_t>(count) * power(RUNNING_BASE, static_cast<uint64_t>(relative_finish));
+}
+
+void add_runnable(RunnableSet &set, int pid) {
+    if (!set.is_runnable[pid] && set.missing[pid] == 0) {
+        set.is_runnable[pid] = true; // mark as runnable
+        set.runnable.push_back(pid);
+    }
+}
+
+void remove_runnable(RunnableSet &set, int pid) {
+    if (set.is_runnable[pid]) {
+        set.is_runnable[pid] = false;
+        set.runnable.erase(std::remove(set.runnable.begin(), set.runnable.end(), pid), set.runnable.end());
+    }
+}
+
+/**
+ * @brief Range of the needers of an item whose quantity is in (low, high], they are sorted by quantity.
+ */
+std::pair<int,int> crossed_needers(const ProcessTable &table, int item_id, int low, int high) {
+    const int *qty = table.needer_qty.data();
+    const int *last = qty + table.needer_offsets[item_id + 1];
+    const int *begin = std::upper_bound(qty + table.needer_offsets[item_id], last, low);
+    const int *end = std::upper_bound(begin, last, high);
+    return {static_cast<int>(begin - qty), static_cast<int>(end - qty)};
+}
+
+void on_stock_increase(RunnableSet &set, const ProcessTable &table, int item_id, int old_val, int new_val) {
+    if (new_val <= old_val) return;
+    // Needers with old_val < need_q <= new_val now have enough of the item
+    const auto [begin, end] = crossed_needers(table, item_id, old_val, new_val);
+    for (int k = begin; k < end; ++k) {
+        const int pid = table.needer_pid[k];
+        if (--set.missing[pid] == 0)
+            add_runnable(set, pid);
+    }
+}
+
+void on_stock_decrease(RunnableSet &set, const ProcessTable &table, int item_id, int old_val, int new_val) {
+    if (new_val >= old_val) return;
+    // Needers with new_val < need_q <= old_val no longer have enough of the item
+    const auto [begin, end] = crossed_needers(table, item_id, new_val, old_val);
+    for (int k = begin; k < end; ++k) {
+        const int pid = table.needer_pid[k];
+        if (set.missing[pid]++ == 0)
+            remove_runnable(set, pid);
+    }
+}
+
+} // namespace
+
+
+uint64_t mix(uint64_t x) {
+    // splitmix64 finalizer
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+
+int score_stocks(const std::vector<int> &stocks, int cycle, const Config &cfg, const ScoreWeights &weights) {
+    if (cfg.optimizeKeys.size() == 1 && cfg.optimizeKeys[0] == "time") {
+        if (cycle == 0) {
+            return 100000; // No running processes, return max score
+        }
+        return 100000 / cycle;
+    }
+
+    std::string target;
+    for (const auto& key : cfg.optimizeKeys) {
+        if (key != "time") {
+            target = key;
+            break; // We only need one target for scoring
+        }
+    }
+
+    const int inf = 1000000; // Arbitrary large value for unreachable stocks
+    const double targetQty = stocks[cfg.item_to_id.at(target)];
+
+    double interm = 0.0;
+    for (size_t i = 0; i < stocks.size(); ++i) {
+        const std::string &s = cfg.id_to_item[i];
+        const int qty = stocks[i];
+        if (s == target || qty <= 0) continue;
+        auto it = cfg.dist.find(s);
+
+        if (it == cfg.dist.end() || it->second >= inf) continue; // unreachable → no credit
+        const double w = std::pow(weights.decay, it->second);
+        interm += w * qty;
+    }
+    return weights.alpha * targetQty + weights.beta * interm;
+}
+
+
+const std::vector<RunningProcess> &running_entries(const RunPQ &running) {
+    // The container of std::priority_queue is a protected member, reachable through a derived class
+    struct Access : RunPQ {
+        static const std::vector<RunningProcess> &entries(const RunPQ &pq) { return pq.*&Access::c; }
+    };
+    return Access::entries(running);
+}
+
+
+uint64_t state_hash(const Candidate &candidate) {
+    return mix(candidate.stock_hash ^ mix(candidate.running_hash));
+}
+
+
+TraceFingerprint trace_fingerprint(const Candidate &candidate, size_t launches) {
+    const size_t end = std::min(launches, candidate.trace.size());
+    uint64_t prefix = mix(end);
+    for (size_t i = 0; i < end; ++i)
+        prefix = mix(prefix ^ (static_cast<uint64_t>(candidate.trace[i].cycle) << 32 | static_cast<uint32_t>(candidate.trace[i].procId)));
+    return {prefix, mix(prefix ^ state_hash(candidate) ^ mix(static_cast<uint64_t>(candidate.cycle)))};
+}
+
+
+void rehash_state(Candidate &candidate) {
+    candidate.stock_hash = 0;
+    for (size_t id = 0; id < candidate.stocks_by_id.size(); ++id)
+        candidate.stock_hash ^= stock_key(static_cast<int>(id), candidate.stocks_by_id[id]);
+    candidate.running_hash = 0;
+    for (const RunningProcess &rp : running_entries(candidate.running))
+        candidate.running_hash += running_key(rp.id, rp.count, rp.finish - candidate.cycle);
+}
+
+
+void init_simulation(Candidate &candidate, const Config &cfg, RunnableSet &set) {
+    candidate.cycle = 0;
+    candidate.stocks_by_id.assign(cfg.item_to_id.size(), 0);
+    for (auto& [name, qty] : cfg.initialStocks)
+        candidate.stocks_by_id[cfg.item_to_id.at(name)] = qty;
+    candidate.trace.clear();
+    candidate.running = RunPQ();
+    candidate.period = TracePeriod();
+    rehash_state(candidate);
+
+    const ProcessTable &table = cfg.table;
+    const int process_count = static_cast<int>(cfg.processes.size());
+    set.missing.assign(process_count, 0);
+    set.is_runnable.assign(process_count, false);
+    set.runnable.clear();
+    set.runnable.reserve(process_count + 1); // +1 for the special -1 ID for waiting next running processes
+    set.parked.clear();
+
+    for (int pid = 0; pid < process_count; ++pid) {
+        for (int k = table.need_offsets[pid]; k < table.need_offsets[pid + 1]; ++k)
+            if (candidate.stocks_by_id[table.need_item[k]] < table.need_qty[k])
+                ++set.missing[pid];
+        if (set.missing[pid] == 0) {
+            set.runnable.push_back(pid);
+            set.is_runnable[pid] = true; // mark as runnable
+        }
+    }
+    set.runnable.push_back(-1); // wait
+}
+
+
+int max_launches(const Candidate &candidate, const Config &cfg, int proc_id) {
+    const ProcessTable &table = cfg.table;
+    const int begin = table.need_offsets[proc_id];
+    const int end = table.need_offsets[proc_id + 1];
+    int count = INT_MAX;
+    for (int k = begin; k < end; ++k) {
+        if (table.need_qty[k] > 0) // a need of quantity 0 bounds nothing
+            count = std::min(count, candidate.stocks_by_id[table.need_item[k]] / table.need_qty[k]);
+    }
+    if (count == INT_MAX)
+        return 1; // nothing bounds a process without needs, launch it once
+    return std::max(count, 0);
+}
+
+
+void max_launches_all(const Candidate &candidate, const Config &cfg, std::vector<int> &counts) {
+    const ProcessTable &table = cfg.table;
+    const size_t need_count = table.need_item.size();
+    const size_t process_count = table.delay.size();
+    thread_local std::vector<double> stock;
+    thread_local std::vector<int> quotient;
+    stock.resize(need_count);
+    quotient.resize(need_count);
+
+    // Gather the stock of each need
+    const int *stocks = candidate.stocks_by_id.data();
+    const int *item = table.need_item.data();
+    double *stock_p = stock.data();
+    for (size_t k = 0; k < need_count; ++k)
+        stock_p[k] = stocks[item[k]];
+
+    // Quotients over contiguous arrays. The double division is exact for 32-bit operands: the rounding error
+    // is below 1 / qty, the distance from a non-integer quotient to the next integer. A need of quantity 0
+    // bounds nothing, like in max_launches.
+    const int *qty = table.need_qty.data();
+    int *quotient_p = quotient.data();
+    for (size_t k = 0; k < need_count; ++k)
+        quotient_p[k] = qty[k] > 0 ? static_cast<int>(stock_p[k] / static_cast<double>(qty[k])) : INT_MAX;
+
+    // Minimum over the needs of each process
+    counts.resize(process_count);
+    for (size_t pid = 0; pid < process_count; ++pid) {
+        const int begin = table.need_offsets[pid];
+        const int end = table.need_offsets[pid + 1];
+        int count = INT_MAX;
+        for (int k = begin; k < end; ++k)
+            count = std::min(count, quotient_p[k]);
+        counts[pid] = count == INT_MAX ? 1 : std::max(count, 0);
+    }
+}
+
+
+void apply_launches(Candidate &candidate, const Config &cfg, int proc_id, int count, RunnableSet &set, bool record) {
+    if (count <= 0)
+        return;
+    const ProcessTable &table = cfg.table;
+
+    // Launch all copies at once
+    candidate.running.emplace(candidate.cycle + table.delay[proc_id], proc_id, count);
+    candidate.running_hash += running_key(proc_id, count, table.delay[proc_id]);
+    for (int k = table.need_offsets[proc_id]; k < table.need_offsets[proc_id + 1]; ++k) {
+        const int id = table.need_item[k];
+        const int before = candidate.stocks_by_id[id];
+        candidate.stocks_by_id[id] -= table.need_qty[k] * count;
+        candidate.stock_hash ^= stock_key(id, before) ^ stock_key(id, candidate.stocks_by_id[id]);
+        on_stock_decrease(set, table, id, before, candidate.stocks_by_id[id]);
+    }
+    if (record)
+        candidate.trace.insert(candidate.trace.end(), static_cast<size_t>(count), TraceEntry{candidate.cycle, proc_id});
+}
+
+
+void wait_next_finish(Candidate &candidate, const Config &cfg, RunnableSet &set) {
+    if (candidate.running.empty())
+        return;
+    const ProcessTable &table = cfg.table;
+    // Finish times are relative to the cycle in the running hash, moving d cycles forward divides it by B^d
+    candidate.running_hash *= power(RUNNING_BASE_INVERSE, static_cast<uint64_t>(candidate.running.top().finish - candidate.cycle));
+    candidate.cycle = candidate.running.top().finish;
+    while (!candidate.running.empty() && candidate.running.top().finish <= candidate.cycle) {
+        const RunningProcess rp = candidate.running.top();
+        candidate.running.pop();
+        candidate.running_hash -= running_key(rp.id, rp.count, 0);
+        for (int k = table.result_offsets[rp.id]; k < table.result_offsets[rp.id + 1]; ++k) {
+            const int id = table.result_item[k];
+            const int before = candidate.stocks_by_id[id];
+            candidate.stocks_by_id[id] += table.result_qty[k] * rp.count;
+            candidate.stock_hash ^= stock_key(id, before) ^ stock_key(id, candidate.stocks_by_id[id]);
+            on_stock_increase(set, table, id, before, candidate.stocks_by_id[id]);
+        }
+    }
+}
+
+
+void finish_running(Candidate &candidate, const Config &cfg) {
+    const ProcessTable &table = cfg.table;
+    for (const RunningProcess &rp : running_entries(candidate.running)) {
+        for (int k = table.result_offsets[rp.id]; k < table.result_offsets[rp.id + 1]; ++k)
+            candidate.stocks_by_id[table.result_item[k]] += table.result_qty[k] * rp.count;
+        candidate.cycle = std::max(candidate.cycle, rp.finish);
+    }
+    candidate.running = RunPQ();
+    rehash_state(candidate);
+}
+
+
+void park_process(RunnableSet &set, int proc_id) {
+    if (set.is_runnable[proc_id]) {
+        remove_runnable(set, proc_id);
+        set.parked.push_back(proc_id);
+    }
+}
+
+
+void restore_parked(RunnableSet &set) {
+    for (int pid : set.parked)
+        add_runnable(set, pid); // skipped if it became unlaunchable or was already put back
+    set.parked.clear();
+}
+
+
+void delete_high_stock_processes(RunnableSet &set, const Config &cfg, const Candidate &candidate)
+{
+    std::vector<int> &runnable_list = set.runnable;
+    if (cfg.maxStocks.limiting_item.empty())
+        return;
+    if (runnable_list.empty() || (runnable_list.size() == 1 && runnable_list[0] == -1)) {
+        return; // nothing to do
+    }
+
+    const int item_count = static_cast<int>(cfg.item_to_id.size());
+    const bool factors_mode = (cfg.maxStocks.limiting_initial_stock == -1);
+    std::vector<bool> over;
+    over.assign(item_count, false);
+
+    // limiting stock for factor caps
+    const int limiting_stock =
+        (cfg.maxStocks.limiting_initial_stock != -1)
+            ? cfg.maxStocks.limiting_initial_stock
+            : (!cfg.maxStocks.limiting_item.empty()
+               ? candidate.stocks_by_id[cfg.item_to_id.at(cfg.maxStocks.limiting_item)]
+               : 0);
+
+    // mark overfull items
+    for (int i = 0; i < item_count; ++i) {
+        const int current_stock = candidate.stocks_by_id[i];
+        const int stock_cap = cfg.maxStocks.abs_cap_by_id[i]; // -1 => no cap
+        const double stock_factor = cfg.maxStocks.factor_by_id[i]; // -1 => no cap
+
+        bool too_much = false;
+        if (!factors_mode && stock_cap >= 0 && current_stock > stock_cap)
+            too_much = true;
+        if (factors_mode && stock_factor >= 0.0 && current_stock > limiting_stock * stock_factor)
+            too_much = true;
+        over[i] = too_much;
+    }
+
+    // helper lambda to check if a process can be dropped
+    auto drop = [&](int pid) {
+        if (pid < 0)
+            return false; // keep wait sentinel
+        const ProcessTable &table = cfg.table;
+        const int begin = table.result_offsets[pid];
+        const int end = table.result_offsets[pid + 1];
+        if (begin == end)
+            return false;
+        for (int k = begin; k < end; ++k)
+            if (!over[table.result_item[k]])
+                return false;
+        return true;
+    };
+
+    // park processes for which all results are overfull
+    int non_wait_runnable = -1;
+    for (auto it = runnable_list.begin(); it != runnable_list.end();) {
+        if (*it < 0) {
+            ++it; // skip wait sentinel
+            continue;
+        }
+        if (non_wait_runnable == -1) {
+            non_wait_runnable = *it; // remember the first runnable process
+        }
+        if (drop(*it)) {
+            set.is_runnable[*it] = false; // mark as not runnable
+            set.parked.push_back(*it);
+            it = runnable_list.erase(it); // remove from runnable list
+        } else {
+            ++it; // keep in runnable list
+        }
+    }
+
+    // if we have no running processes and no runnable processes, we can add back the first non-wait runnable process
+    if (candidate.running.empty() && non_wait_runnable != -1 && (runnable_list.empty() || (runnable_list.size() == 1 && runnable_list[0] == -1))) {
+        add_runnable(set, non_wait_runnable);
+    }
+
+}
+
+
+bool SteadyStateDetector::observe(const Candidate &candidate, TracePeriod &period, std::vector<int> &stock_delta) {
+    std::vector<RunningProcess> running = relative_running(candidate);
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+    for (const RunningProcess &rp : running) {
+        hash = (hash ^ static_cast<uint64_t>(rp.finish)) * 1099511628211ull;
+        hash = (hash ^ static_cast<uint64_t>(rp.id)) * 1099511628211ull;
+        hash = (hash ^ static_cast<uint64_t>(rp.count)) * 1099511628211ull;
+    }
+
+    auto it = states_.find(hash);
+    if (it != states_.end()) {
+        const State &state = it->second;
+        const bool same_running = state.running.size() == running.size()
+            && std::equal(running.begin(), running.end(), state.running.begin(),
+                          [](const RunningProcess &a, const RunningProcess &b) { return a.finish == b.finish && a.id == b.id && a.count == b.count; });
+        bool no_consumption = same_running;
+        for (size_t id = 0; no_consumption && id < state.stocks.size(); ++id)
+            no_consumption = candidate.stocks_by_id[id] >= state.stocks[id];
+        if (no_consumption && candidate.cycle > state.cycle && candidate.trace.size() > state.trace_size) {
+            period.start = state.trace_size;
+            period.length = candidate.trace.size() - state.trace_size;
+            period.shift = candidate.cycle - state.cycle;
+            period.times = 1;
+            stock_delta.resize(state.stocks.size());
+            for (size_t id = 0; id < state.stocks.size(); ++id)
+                stock_delta[id] = candidate.stocks_by_id[id] - state.stocks[id];
+            return true;
+        }
+    } else if (states_.size() >= max_states_) {
+        return false;
+    }
+    states_[hash] = State{std::move(running), candidate.stocks_by_id, candidate.cycle, candidate.trace.size()};
+    return false;
+}
+
+
+std::vector<RunningProcess> SteadyStateDetector::relative_running(const Candidate &candidate) {
+    RunPQ copy = candidate.running;
+    std::vector<RunningProcess> running;
+    running.reserve(copy.size());
+    for (; !copy.empty(); copy.pop())
+        running.emplace_back(copy.top().finish - candidate.cycle, copy.top().id, copy.top().count);
+    std::sort(running.begin(), running.end(), [](const RunningProcess &a, const RunningProcess &b) {
+        return a.finish != b.finish ? a.finish < b.finish : a.id < b.id;
+    });
+    // Copies launched in different steps but finishing together are the same state
+    size_t merged = 0;
+    for (size_t j = 0; j < running.size(); ++j) {
+        if (merged > 0 && running[merged - 1].finish == running[j].finish && running[merged - 1].id == running[j].id)
+            running[merged - 1].count += running[j].count;
+        else
+            running[merged++] = running[j];
+    }
+    running.resize(merged);
+    return running;
+}
+
+
+void extrapolate_steady_state(Candidate &candidate, TracePeriod period, const std::vector<int> &stock_delta, int maxCycles) {
+    long extra = (static_cast<long>(maxCycles) - candidate.cycle + period.shift - 1) / period.shift;
+    extra = std::min(extra, (INT_MAX - static_cast<long>(candidate.cycle)) / period.shift);
+    for (size_t id = 0; id < stock_delta.size(); ++id) {
+        if (stock_delta[id] > 0)
+            extra = std::min(extra, (INT_MAX - static_cast<long>(candidate.stocks_by_id[id])) / stock_delta[id]);
+    }
+    if (extra <= 0)
+        return;
+
+    const int shift = static_cast<int>(extra * period.shift);
+    for (size_t id = 0; id < stock_delta.size(); ++id)
+        candidate.stocks_by_id[id] += static_cast<int>(extra * stock_delta[id]);
+    RunPQ running;
+    for (; !candidate.running.empty(); candidate.running.pop())
+        running.emplace(candidate.running.top().finish + shift, candidate.running.top().id, candidate.running.top().count);
+    candidate.running = std::move(running);
+    candidate.cycle += shift;
+    rehash_state(candidate);
+    period.times = extra + 1;
+    candidate.period = period;
+}
+
+
+bool wait_and_detect_steady_state(Candidate &candidate, const Config &cfg, RunnableSet &set,
+                                  SteadyStateDetector &steady_state, int maxCycles) {
+    wait_next_finish(candidate, cfg, set);
+    // Once the state repeats, the rest of the simulation is the same period over and over
+    TracePeriod period;
+    std::vector<int> stock_delta;
+    if (candidate.running.empty() || !steady_state.observe(candidate, period, stock_delta))
+        return false;
+    extrapolate_steady_state(candidate, period, stock_delta, maxCycles);
+    return true;
+}
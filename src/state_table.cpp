@@ -0,0 +1,54 @@
+/*!
+ *  @file state_table.cpp
+ *  @brief Implementation of the table of the simulation states reached by the krpsim solvers
+ */
+
+#include "state_table.hpp"
+
+#include <climits>
+
+
+namespace {
+
+constexpr size_t MAX_PROBES = 64;   ///< Slots visited for a hash before the table is considered full around it
+
+} // namespace
+
+
+StateTable::StateTable(size_t capacity) {
+    size_t slots = 1;
+    while (slots < capacity)
+        slots <<= 1;
+    mask_ = slots - 1;
+    keys_ = std::make_unique<std::atomic<uint64_t>[]>(slots);
+    cycles_ = std::make_unique<std::atomic<int>[]>(slots);
+    for (size_t slot = 0; slot < slots; ++slot) {
+        keys_[slot].store(0, std::memory_order_relaxed);
+        cycles_[slot].store(INT_MAX, std::memory_order_relaxed);
+    }
+}
+
+
+bool StateTable::visit(uint64_t hash, int cycle) {
+    const uint64_t key = hash ? hash : 1; // 0 marks the free slots
+    for (size_t probe = 0; probe < MAX_PROBES; ++probe) {
+        const size_t slot = (key + probe) & mask_;
+        uint64_t found = keys_[slot].load(std::memory_order_acquire);
+        if (found == 0) {
+            if (keys_[slot].compare_exchange_strong(found, key, std::memory_order_acq_rel)) {
+                size_.fetch_add(1, std::memory_order_relaxed);
+                found = key;
+            }
+        }
+        if (found != key)
+            continue;
+        // Keep the earliest cycle, a later one is dominated
+        int earliest = cycles_[slot].load(std::memory_order_relaxed);
+        while (cycle < earliest) {
+            if (cycles_[slot].compare_exchange_weak(earliest, cycle, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+    return true;
+}
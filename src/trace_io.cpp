@@ -0,0 +1,320 @@
+/*!
+ *  @file trace_io.cpp
+ *  @brief Implementation of the trace output of krpsim.
+ *
+ *  The writer formats integers with std::to_chars in a large buffer and writes it with write(2) in big chunks.
+ *  The binary trace encoder/decoder use delta + varint encoding of the entries.
+ */
+
+#include "trace_io.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+TraceWriter::TraceWriter(int fd, size_t buffer_size) : fd_(fd), owns_fd_(false), buffer_(buffer_size) {}
+
+
+TraceWriter::TraceWriter(const std::string &path, size_t buffer_size)
+    : fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)), owns_fd_(true), buffer_(buffer_size) {
+    if (fd_ < 0)
+        throw std::runtime_error("Cannot open output file " + path + ": " + std::strerror(errno));
+}
+
+
+TraceWriter::~TraceWriter() {
+    try {
+        flush();
+    } catch (const std::exception &) {
+        // Destructor must not throw, call flush() explicitly to get errors
+    }
+    if (owns_fd_)
+        ::close(fd_);
+}
+
+
+/**
+ * @brief Make sure at least bytes are available at the end of the buffer, flushing if needed.
+ */
+void TraceWriter::reserve(size_t bytes) {
+    if (buffer_.size() - used_ >= bytes)
+        return;
+    flush();
+    if (buffer_.size() < bytes)
+        buffer_.resize(bytes);
+}
+
+
+void TraceWriter::write(std::string_view text) {
+    reserve(text.size());
+    std::memcpy(buffer_.data() + used_, text.data(), text.size());
+    used_ += text.size();
+}
+
+
+void TraceWriter::write(long value) {
+    reserve(24);
+    auto [ptr, ec] = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(), value);
+    (void)ec; // 24 bytes always fit a long
+    used_ = ptr - buffer_.data();
+}
+
+
+void TraceWriter::put(char c) {
+    reserve(1);
+    buffer_[used_++] = c;
+}
+
+
+void TraceWriter::write_entry(long cycle, std::string_view name) {
+    reserve(name.size() + 26);
+    char *out = buffer_.data() + used_;
+    out = std::to_chars(out, out + 24, cycle).ptr;
+    *out++ = ':';
+    std::memcpy(out, name.data(), name.size());
+    out += name.size();
+    *out++ = '\n';
+    used_ = out - buffer_.data();
+}
+
+
+void TraceWriter::write_repeat(const TracePeriod &period) {
+    write("@repeat:");
+    write(static_cast<long>(period.length));
+    put(':');
+    write(period.shift);
+    put(':');
+    write(period.times);
+    put('\n');
+}
+
+
+void TraceWriter::flush() {
+    size_t done = 0;
+    while (done < used_) {
+        const ssize_t written = ::write(fd_, buffer_.data() + done, used_ - done);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            used_ = 0;
+            throw std::runtime_error(std::string("Cannot write trace: ") + std::strerror(errno));
+        }
+        done += static_cast<size_t>(written);
+    }
+    used_ = 0;
+}
+
+
+/**
+ * @brief Append an unsigned LEB128 varint to a string.
+ */
+static void put_varint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+
+/**
+ * @brief Append a fixed-size little endian integer to a string.
+ */
+template <typename T>
+static void put_le(std::string &out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i)
+        out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+}
+
+
+/**
+ * @brief Read a fixed-size little endian integer from bytes.
+ */
+template <typename T>
+static T get_le(const unsigned char *bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+        value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    return static_cast<T>(value);
+}
+
+
+void BinaryTraceEncoder::add(long cycle, uint32_t pid) {
+    const int64_t delta = static_cast<int64_t>(cycle) - static_cast<int64_t>(prev_cycle_);
+    put_varint(body_, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63)); // zigzag
+    put_varint(body_, pid);
+    prev_cycle_ = cycle;
+    ++count_;
+}
+
+
+void BinaryTraceEncoder::add_repeat(const TracePeriod &period) {
+    put_varint(body_, 0); // no cycle delta
+    put_varint(body_, process_count_);
+    put_varint(body_, period.length);
+    put_varint(body_, (static_cast<uint64_t>(period.shift) << 1) ^ static_cast<uint64_t>(period.shift >> 63));
+    put_varint(body_, static_cast<uint64_t>(period.times));
+    ++count_;
+}
+
+
+void BinaryTraceEncoder::write(TraceWriter &out, uint64_t config_hash) const {
+    std::string header(BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC));
+    header.push_back(static_cast<char>(BINARY_TRACE_VERSION));
+    header.append(3, '\0');
+    put_le<uint64_t>(header, config_hash);
+    put_le<uint32_t>(header, process_count_);
+    put_le<uint64_t>(header, count_);
+    out.write(header);
+    out.write(body_);
+}
+
+
+///< @brief Size of the binary trace header in bytes.
+static constexpr size_t BINARY_HEADER_SIZE = 4 + 4 + 8 + 4 + 8;
+
+
+BinaryTraceReader::BinaryTraceReader(std::FILE *file) : file_(file), buffer_(1 << 20) {
+    unsigned char raw[BINARY_HEADER_SIZE];
+    if (std::fread(raw, 1, sizeof(raw), file_) != sizeof(raw)
+        || std::memcmp(raw, BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC)) != 0)
+        throw std::runtime_error("Not a binary trace");
+    if (raw[4] != 1 && raw[4] != BINARY_TRACE_VERSION) // version 1 has no repeat directive
+        throw std::runtime_error("Unsupported binary trace version " + std::to_string(raw[4]));
+    header_.config_hash = get_le<uint64_t>(raw + 8);
+    header_.process_count = get_le<uint32_t>(raw + 16);
+    header_.entry_count = get_le<uint64_t>(raw + 20);
+}
+
+
+/**
+ * @brief Move the unread bytes to the front of the buffer and read more data.
+ * @return false if no more data could be read.
+ */
+bool BinaryTraceReader::fill() {
+    std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+    const size_t read = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+    end_ += read;
+    return read > 0;
+}
+
+
+/**
+ * @brief Decode an unsigned LEB128 varint.
+ */
+uint64_t BinaryTraceReader::read_varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (begin_ == end_ && !fill())
+            throw std::runtime_error("Truncated binary trace");
+        const auto byte = static_cast<unsigned char>(buffer_[begin_++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    throw std::runtime_error("Malformed varint in binary trace");
+}
+
+
+bool BinaryTraceReader::next(long &cycle, uint32_t &pid) {
+    if (read_ == header_.entry_count)
+        return false;
+    const uint64_t zigzag = read_varint();
+    const int64_t delta = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+    const uint64_t id = read_varint();
+    if (id > UINT32_MAX)
+        throw std::runtime_error("Malformed process ID in binary trace");
+    cycle_ += delta;
+    cycle = cycle_;
+    pid = static_cast<uint32_t>(id);
+    if (pid == header_.process_count) {
+        repeat_.length = read_varint();
+        const uint64_t shift = read_varint();
+        repeat_.shift = static_cast<long>(static_cast<int64_t>(shift >> 1) ^ -static_cast<int64_t>(shift & 1));
+        const uint64_t times = read_varint();
+        if (times > static_cast<uint64_t>(std::numeric_limits<long>::max()))
+            throw std::runtime_error("Malformed repeat directive in binary trace");
+        repeat_.times = static_cast<long>(times);
+    }
+    ++read_;
+    return true;
+}
+
+
+bool is_binary_trace(std::FILE *file) {
+    char magic[sizeof(BINARY_TRACE_MAGIC)];
+    const size_t read = std::fread(magic, 1, sizeof(magic), file);
+    std::rewind(file);
+    return read == sizeof(magic) && std::memcmp(magic, BINARY_TRACE_MAGIC, sizeof(magic)) == 0;
+}
+
+
+TracePeriod find_trace_period(const std::vector<TraceEntry> &trace, size_t max_length) {
+    TracePeriod best;
+    const size_t n = trace.size();
+    size_t best_saved = 0;
+
+    for (size_t length = 1; length <= max_length && 2 * length <= n; ++length) {
+        // Longest run of i where trace[i + length] is trace[i] shifted by the same number of cycles
+        size_t run_start = 0;
+        size_t run = 0;
+        long run_shift = 0;
+        for (size_t i = 0; i + length < n; ++i) {
+            const long shift = trace[i + length].cycle - trace[i].cycle;
+            const bool match = trace[i + length].procId == trace[i].procId && shift > 0;
+            if (match && run > 0 && shift == run_shift) {
+                ++run;
+            } else if (match) {
+                run_start = i;
+                run = 1;
+                run_shift = shift;
+            } else {
+                run = 0;
+            }
+            if (run > 0) {
+                // The run covers run + length entries from run_start
+                const size_t times = (run + length) / length;
+                const size_t saved = (times - 1) * length;
+                if (times > 1 && saved > best_saved) {
+                    best_saved = saved;
+                    best.start = run_start;
+                    best.length = length;
+                    best.shift = run_shift;
+                    best.times = static_cast<long>(times);
+                }
+            }
+        }
+    }
+    return best;
+}
+
+
+void compress_trace(std::vector<TraceEntry> &trace, const TracePeriod &period) {
+    if (!period.active())
+        return;
+    const auto first = trace.begin() + static_cast<long>(period.start + period.length);
+    trace.erase(first, first + static_cast<long>(period.length * (period.times - 1)));
+}
+
+
+std::vector<TraceEntry> expand_trace(const std::vector<TraceEntry> &trace, const TracePeriod &period) {
+    if (!period.active())
+        return trace;
+    std::vector<TraceEntry> expanded;
+    expanded.reserve(trace.size() + period.length * (period.times - 1));
+    expanded.insert(expanded.end(), trace.begin(), trace.begin() + static_cast<long>(period.start + period.length));
+    for (long k = 1; k < period.times; ++k) {
+        for (size_t i = period.start; i < period.start + period.length; ++i)
+            expanded.push_back({trace[i].cycle + k * period.shift, trace[i].procId});
+    }
+    expanded.insert(expanded.end(), trace.begin() + static_cast<long>(period.start + period.length), trace.end());
+    return expanded;
+}
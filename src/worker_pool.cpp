@@ -0,0 +1,76 @@
+/*!
+ *  @file worker_pool.cpp
+ *  @brief Implementation of the pool of threads used by the krpsim solvers
+ */
+
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+
+WorkerPool::WorkerPool(unsigned worker_count) {
+    if (worker_count == 0)
+        worker_count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned worker = 1; worker < worker_count; ++worker)
+        threads_.emplace_back(&WorkerPool::work, this, worker);
+}
+
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (std::thread &thread : threads_)
+        thread.join();
+}
+
+
+void WorkerPool::run(size_t task_count, const std::function<void(size_t, unsigned)> &task) {
+    if (threads_.empty() || task_count <= 1) {
+        for (size_t index = 0; index < task_count; ++index)
+            task(index, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        task_count_ = task_count;
+        next_ = 0;
+        busy_ = static_cast<unsigned>(threads_.size());
+        ++round_;
+    }
+    start_.notify_all();
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return busy_ == 0; });
+    task_ = nullptr;
+}
+
+
+void WorkerPool::drain(unsigned worker) {
+    for (size_t index = next_++; index < task_count_; index = next_++)
+        (*task_)(index, worker);
+}
+
+
+void WorkerPool::work(unsigned worker) {
+    unsigned long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&]() { return stop_ || round_ != seen; });
+            if (stop_)
+                return;
+            seen = round_;
+        }
+        drain(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busy_;
+        }
+        done_.notify_one();
+    }
+}
@@ -0,0 +1,35 @@
+#!/usr/bin/env bash
+# Check that the Pareto front member krpsim reports matches a replay of its trace by krpsim_verif.
+#
+# Usage: tests/pareto_replay.sh <config-file> <delay_in_sec> [<tradeoff>...]
+# e.g.   tests/pareto_replay.sh configs/42_project 2 project:1 time:1
+# For each trade-off (every objective weighing 1 if none is given), the total cycles and final stocks of the report
+# must equal the final cycle and stocks of the replay. Exits 1 on the first mismatch. Run from the repository root,
+# after make.
+set -euo pipefail
+
+config=${1:?config file}
+delay=${2:?delay}
+shift 2
+[ $# -gt 0 ] || set -- ""
+
+report=$(mktemp)
+trap 'rm -f "$report"' EXIT
+
+for tradeoff in "$@"; do
+    ./krpsim --solver=pareto ${tradeoff:+--tradeoff="$tradeoff"} --output="$report" "$config" "$delay"
+    reported=$(awk '/^Total cycles:/ { sub("Total cycles:", ""); print "cycle " $0 }
+                    /^Final stock:/ { stocks = 1; next }
+                    stocks && /^$/ { stocks = 0 }
+                    stocks { sub(":", ""); print $1 " " $2 }' "$report" | sort)
+    replayed=$(./krpsim_verif "$config" "$report" \
+        | awk '/^Final cycle:/ { print "cycle " $3 }
+               /^Final stocks:/ { stocks = 1; next }
+               stocks && NF == 2 { sub(":", "", $1); print $1 " " $2 }' | sort)
+    if [ "$reported" != "$replayed" ]; then
+        echo "${tradeoff:-default}: the report does not match the replay"
+        diff <(echo "$reported") <(echo "$replayed") || true
+        exit 1
+    fi
+    echo "${tradeoff:-default}: ok"
+done